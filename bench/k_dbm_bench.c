@@ -0,0 +1,119 @@
+/**
+ * @file k_dbm_bench.c
+ * @ingroup k_dbm
+ * @brief Microbenchmarks for the Database Manager hot paths
+ * @{
+ */
+
+/* Include -------------------------------------------------------------------*/
+#define _POSIX_C_SOURCE 199309L
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "k_dbm.h"
+#include "k_dbm_priv.h"
+
+/* Macro ---------------------------------------------------------------------*/
+#define K_DBM_BENCH_ROUNDS (20000)
+
+/* Typedef -------------------------------------------------------------------*/
+/* Function Declaration ------------------------------------------------------*/
+static int		bench_mutex_lock(int timeout_ms);
+static void		bench_mutex_unlock(void);
+static int		bench_nvm_insert(const char *key, const char *value);
+static int		bench_nvm_get(const char *key, char *value, size_t value_buffer_size);
+static int		bench_nvm_delete(const char *key);
+static uint64_t bench_now_ns(void);
+
+/* Constant ------------------------------------------------------------------*/
+static const k_dbm_config_t bench_config = {
+	.k_dbm_lock_mutex_f	  = bench_mutex_lock,
+	.k_dbm_unlock_mutex_f = bench_mutex_unlock,
+	.k_dbm_insert_f		  = bench_nvm_insert,
+	.k_dbm_get_f		  = bench_nvm_get,
+	.k_dbm_delete_f		  = bench_nvm_delete,
+};
+
+/* Variable ------------------------------------------------------------------*/
+static char bench_keys[K_DBM_DB_SIZE][32];
+
+/* Function Definition -------------------------------------------------------*/
+int main(void)
+{
+	uint64_t insert_ns = 0;
+	uint64_t update_ns = 0;
+
+	k_dbm_init(&bench_config);
+	for (size_t i = 0; i < K_DBM_DB_SIZE; i++)
+	{
+		snprintf(bench_keys[i], sizeof(bench_keys[i]), "sensor/zone3/probe%zu", i);
+	}
+
+	for (size_t round = 0; round < K_DBM_BENCH_ROUNDS; round++)
+	{
+		/* Insert case: every key is new, the table fills up to K_DBM_DB_SIZE */
+		const uint64_t start = bench_now_ns();
+		for (size_t i = 0; i < K_DBM_DB_SIZE; i++)
+		{
+			k_dbm_insert(bench_keys[i], "1", K_DBM_STORAGE_RAM);
+		}
+		insert_ns += bench_now_ns() - start;
+
+		/* Update case: every key is already present */
+		const uint64_t update_start = bench_now_ns();
+		for (size_t i = 0; i < K_DBM_DB_SIZE; i++)
+		{
+			k_dbm_insert(bench_keys[i], "2", K_DBM_STORAGE_RAM);
+		}
+		update_ns += bench_now_ns() - update_start;
+
+		for (size_t i = 0; i < K_DBM_DB_SIZE; i++)
+		{
+			k_dbm_delete(bench_keys[i]);
+		}
+	}
+
+	const double ops = (double)K_DBM_BENCH_ROUNDS * K_DBM_DB_SIZE;
+	printf("k_dbm_bench: K_DBM_DB_SIZE=%d\n", K_DBM_DB_SIZE);
+	printf("insert (new key): %8.1f ns/op\n", (double)insert_ns / ops);
+	printf("insert (update):  %8.1f ns/op\n", (double)update_ns / ops);
+	return 0;
+}
+
+static int bench_mutex_lock(int timeout_ms)
+{
+	(void)timeout_ms;
+	return 0;
+}
+
+static void bench_mutex_unlock(void) {}
+
+static int bench_nvm_insert(const char *key, const char *value)
+{
+	(void)key;
+	(void)value;
+	return 0;
+}
+
+static int bench_nvm_get(const char *key, char *value, size_t value_buffer_size)
+{
+	(void)key;
+	(void)value;
+	(void)value_buffer_size;
+	return -1;
+}
+
+static int bench_nvm_delete(const char *key)
+{
+	(void)key;
+	return 0;
+}
+
+static uint64_t bench_now_ns(void)
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (uint64_t)now.tv_sec * 1000000000u + (uint64_t)now.tv_nsec;
+}
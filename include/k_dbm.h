@@ -11,7 +11,9 @@ extern "C"
 #endif
 
 /* Include -------------------------------------------------------------------*/
+#include <stdbool.h>
 #include <stddef.h>
+#include <stdint.h>
 
 /* Macro ---------------------------------------------------------------------*/
 #define K_DBM_LOCK_MUTEX_INFINITE_TIMEOUT (-1)
@@ -70,6 +72,42 @@ typedef int (*k_dbm_insert_t)(const char *key, const char *value);
  */
 typedef int (*k_dbm_get_t)(const char *key, char *value, size_t value_buffer_size);
 
+/**
+ * @brief Function pointer type for inserting a binary value into the database
+ *
+ * @param key The key to insert
+ * @param data The value associated with the key
+ * @param data_len Length of the value in bytes
+ *
+ * @return Returns 0 on success, -1 on failure
+ */
+typedef int (*k_dbm_insert_blob_t)(const char *key, const void *data, size_t data_len);
+
+/**
+ * @brief Function pointer type for retrieving a binary value by key from the database
+ *
+ * @param key The key to retrieve
+ * @param buffer Buffer to store the retrieved value
+ * @param buffer_size Size of the buffer
+ * @param data_len Length of the value, also to be set when the value does not fit in the buffer
+ *
+ * @return Returns 0 on success, -1 on failure
+ */
+typedef int (*k_dbm_get_blob_t)(const char *key, void *buffer, size_t buffer_size, size_t *data_len);
+
+/**
+ * @brief Function pointer type for retrieving several values from the database with a single access
+ *
+ * @param keys The keys to retrieve
+ * @param key_count Number of keys
+ * @param values key_count consecutive buffers of value_buffer_size bytes, buffer i receives the value of keys[i]
+ * @param value_buffer_size Size of each value buffer
+ * @param results results[i] is to be set to 0 if keys[i] has been retrieved, -1 otherwise
+ *
+ * @return Returns 0 if the batch has been processed, -1 on failure
+ */
+typedef int (*k_dbm_get_batch_t)(const char *const *keys, size_t key_count, char *values, size_t value_buffer_size, int *results);
+
 /**
  * @brief Function pointer type for deleting a key-value pair from the database
  *
@@ -79,6 +117,88 @@ typedef int (*k_dbm_get_t)(const char *key, char *value, size_t value_buffer_siz
  */
 typedef int (*k_dbm_delete_t)(const char *key);
 
+/**
+ * @brief Function pointer type for deleting from the database every key starting with a prefix
+ *
+ * @param prefix Prefix of the keys to delete
+ *
+ * @return Returns 0 on success, -1 on failure
+ */
+typedef int (*k_dbm_delete_prefix_t)(const char *prefix);
+
+/**
+ * @brief Callback invoked for every key reported by k_dbm_enumerate_f
+ *
+ * @param key_p Key stored in NVM, only needs to be valid during the call
+ * @param ctx_p Context given to k_dbm_enumerate_f
+ *
+ * @return 0 to continue the enumeration, any other value to stop it
+ */
+typedef int (*k_dbm_enumerate_cb_t)(const char *key_p, void *ctx_p);
+
+/**
+ * @brief Function pointer type for enumerating every key stored in NVM
+ *
+ * The callback of k_dbm_delete_prefix deletes the reported key with k_dbm_delete_f before returning, the enumeration
+ * must carry on past a deleted key.
+ *
+ * @param callback_f Callback to invoke for every key
+ * @param ctx_p Context to pass to the callback
+ *
+ * @return Returns 0 if every key was reported, -1 on failure
+ */
+typedef int (*k_dbm_enumerate_t)(k_dbm_enumerate_cb_t callback_f, void *ctx_p);
+
+/**
+ * @brief Task run by k_dbm_run_async_f
+ *
+ * @param ctx_p Context given to k_dbm_run_async_f
+ */
+typedef void (*k_dbm_task_t)(void *ctx_p);
+
+/**
+ * @brief Function pointer type for running a task in the background, e.g. on a worker thread
+ *
+ * @param task_f Task to run once
+ * @param ctx_p Context to pass to the task
+ *
+ * @return Returns 0 if the task has been scheduled, -1 otherwise
+ */
+typedef int (*k_dbm_run_async_t)(k_dbm_task_t task_f, void *ctx_p);
+
+/**
+ * @brief Function pointer type for reading a monotonic time
+ *
+ * @return Returns the time in milliseconds, wrapping around is allowed
+ */
+typedef uint32_t (*k_dbm_get_time_ms_t)(void);
+
+/**
+ * @brief Callback invoked for every entry reported by k_dbm_scan_prefix
+ *
+ * @note The callback runs with the DB mutex held and must not call any k_dbm function
+ * @param key_p Entry key
+ * @param value_p Entry value, NULL terminated. Binary values may also contain NULL bytes, typed values are in native binary form
+ * @param value_len Length of the value, terminator excluded
+ * @param ctx_p User context given to k_dbm_scan_prefix
+ *
+ * @return 0 to continue the scan, any other value to stop it
+ */
+typedef int (*k_dbm_scan_cb_t)(const char *key_p, const char *value_p, size_t value_len, void *ctx_p);
+
+/**
+ * @brief Cache statistics, counted since k_dbm_init
+ */
+typedef struct
+{
+	uint32_t cache_hits;		   //!< Reads served from RAM
+	uint32_t cache_misses;		   //!< Reads of keys not cached in RAM, whether they were found in NVM or not, warm-up and prefetch loads excluded
+	uint32_t evictions;			   //!< Cached NVM entries evicted to cache another key
+	uint32_t admissions_rejected;  //!< NVM reads left uncached because the admission policy preferred the entry to evict
+	uint32_t writes_coalesced;	   //!< NVM writes avoided, a deferred value was superseded by a newer value of the same key before being saved
+	uint32_t writes_skipped;	   //!< NVM writes avoided, the value was the same as the cached one
+} k_dbm_stats_t;
+
 /**
  * @brief Configuration structure for the database manager
  *
@@ -86,11 +206,22 @@ typedef int (*k_dbm_delete_t)(const char *key);
  */
 typedef struct
 {
-	k_dbm_lock_mutex_t	 k_dbm_lock_mutex_f;	//!< Function pointer for locking a mutex
-	k_dbm_unlock_mutex_t k_dbm_unlock_mutex_f;	//!< Function pointer for unlocking a mutex
-	k_dbm_insert_t		 k_dbm_insert_f;		//!< Function pointer for inserting a key-value pair
-	k_dbm_get_t			 k_dbm_get_f;			//!< Function pointer for retrieving a value by key
-	k_dbm_delete_t		 k_dbm_delete_f;		//!< Function pointer for deleting a key-value pair
+	k_dbm_lock_mutex_t	  k_dbm_lock_mutex_f;	  //!< Function pointer for locking a mutex
+	k_dbm_unlock_mutex_t  k_dbm_unlock_mutex_f;	  //!< Function pointer for unlocking a mutex
+	k_dbm_insert_t		  k_dbm_insert_f;		  //!< Function pointer for inserting a key-value pair
+	k_dbm_get_t			  k_dbm_get_f;			  //!< Function pointer for retrieving a value by key
+	k_dbm_delete_t		  k_dbm_delete_f;		  //!< Function pointer for deleting a key-value pair
+	k_dbm_delete_prefix_t k_dbm_delete_prefix_f;  //!< Optional function pointer for deleting every key under a prefix in one call
+	k_dbm_enumerate_t	  k_dbm_enumerate_f;	  //!< Optional function pointer for enumerating the NVM keys, used to build the NVM key filter and by k_dbm_delete_prefix
+	k_dbm_insert_blob_t	  k_dbm_insert_blob_f;	  //!< Optional function pointer for inserting a binary value, required to save blobs and typed values in NVM
+	k_dbm_get_blob_t	  k_dbm_get_blob_f;		  //!< Optional function pointer for retrieving a binary value, k_dbm_get_f is used if NULL. Required to load typed values from NVM
+	k_dbm_run_async_t	  k_dbm_run_async_f;	  //!< Optional function pointer for running background work, k_dbm_warmup and k_dbm_prefetch run in the caller thread if NULL
+	k_dbm_get_batch_t	  k_dbm_get_batch_f;	  //!< Optional function pointer for retrieving several values at once, used by k_dbm_warmup and k_dbm_prefetch
+	k_dbm_get_time_ms_t	  k_dbm_get_time_ms_f;	  //!< Optional function pointer for reading the time, required by write_back_max_age_ms
+	bool				  is_write_back;		  //!< true to only mark NVM writes dirty in RAM, they are saved by k_dbm_flush or when a threshold is reached
+	size_t				  write_back_dirty_max;	  //!< Write-back mode, number of dirty entries that triggers a flush, 0 for no limit
+	uint32_t			  write_back_max_age_ms;  //!< Write-back mode, age in ms of the oldest dirty value that triggers a flush, 0 for no limit
+	uint32_t			  write_coalesce_ms;	  //!< Window in ms from the first deferred write of a key to its save, so only its last value is saved, 0 to disable. Requires k_dbm_get_time_ms_f
 } k_dbm_config_t;
 
 /* Constant ------------------------------------------------------------------*/
@@ -109,6 +240,15 @@ typedef struct
  *                 - k_dbm_insert_f: Function for inserting key-value pairs
  *                 - k_dbm_get_f: Function for retrieving values by key
  *                 - k_dbm_delete_f: Function for deleting key-value pairs
+ *                 - k_dbm_delete_prefix_f: Optional function for deleting every key under a prefix
+ *                 - k_dbm_enumerate_f: Optional function for enumerating the NVM keys, called once here to
+ *                   build the NVM key filter (K_DBM_NVM_FILTER_SIZE)
+ *                 - k_dbm_insert_blob_f, k_dbm_get_blob_f: Optional functions moving binary values to and from NVM
+ *                 - k_dbm_run_async_f: Optional function running background work
+ *                 - k_dbm_get_batch_f: Optional function retrieving several values at once
+ *                 - k_dbm_get_time_ms_f: Optional function reading the time
+ *                 - is_write_back, write_back_dirty_max, write_back_max_age_ms: Optional write-back mode of the NVM writes
+ *                 - write_coalesce_ms: Optional coalescing window of the NVM writes
  *
  * @note Configuration will be copied
  * @return Returns 0 on successful initialization
@@ -116,7 +256,7 @@ typedef struct
  *         - config_p is NULL
  *         - Any of the required function pointers in config_p is NULL
  *
- * @note All function pointers in the configuration structure must be valid (non-NULL)
+ * @note All function pointers in the configuration structure, except the optional ones, must be valid (non-NULL)
  *       for successful initialization.
  */
 
@@ -125,6 +265,9 @@ int k_dbm_init(const k_dbm_config_t *config_p);
 /**
  * @brief Insert a key-value pair entry into the DB
  *
+ * @note Unless the key arena is enabled (K_DBM_KEY_ARENA_SIZE), the key pointer is stored as is and must stay valid
+ *       until the entry is deleted.
+ *
  * @param key_p Entry key
  * @param value_p Entry value
  * @param storage Storage where the pair will be saved
@@ -132,11 +275,41 @@ int k_dbm_init(const k_dbm_config_t *config_p);
  */
 int k_dbm_insert(const char *key_p, const char *value_p, k_dbm_storage_t storage);
 
+/**
+ * @brief Insert a value for a key of the compile-time key registry
+ *
+ * The entry of a registry key is reserved at build time, so the key is resolved by array index
+ * without hashing nor string comparison. The same entry is reachable through k_dbm_insert with the key string.
+ *
+ * @param key_id Key identifier from the generated k_dbm_keys.h (K_DBM_KEY_...)
+ * @param value_p Entry value
+ * @param storage Storage where the pair will be saved
+ * @return 0 in case of success, -1 otherwise (including an unknown key_id)
+ */
+int k_dbm_insert_by_id(size_t key_id, const char *value_p, k_dbm_storage_t storage);
+
+/**
+ * @brief Insert a binary value into the DB
+ *
+ * The value is stored with its length and is never interpreted, so it can hold NULL bytes.
+ * Saving it in NVM requires k_dbm_insert_blob_f. A value starting with a NULL byte is saved with a second one,
+ * so it is not taken for a typed record when read back.
+ *
+ * @param key_p Entry key
+ * @param data_p Entry value, may be NULL if data_len is 0
+ * @param data_len Length of the value in bytes, lower than K_DBM_VALUE_MAX_LENGTH
+ * @param storage Storage where the pair will be saved
+ * @return 0 in case of success, -1 otherwise
+ */
+int k_dbm_insert_blob(const char *key_p, const void *data_p, size_t data_len, k_dbm_storage_t storage);
+
 /**
  * @brief Get a value by key from the database
  *
  * This function retrieves a value associated with a given key from the database.
  * @note Keys must be const char* and values are stored in a buffer provided by the caller.
+ *       Binary values inserted with k_dbm_insert_blob are not returned, use k_dbm_get_blob.
+ *       Typed values cached in RAM are returned formatted as decimal strings ("1"/"0" for booleans).
  *
  *
  * @param key_p Pointer to the key for which the value is to be retrieved
@@ -147,6 +320,112 @@ int k_dbm_insert(const char *key_p, const char *value_p, k_dbm_storage_t storage
  */
 int k_dbm_get(const char *key_p, char *value_buffer_p, size_t value_buffer_size);
 
+/**
+ * @brief Get the value of a key as binary data
+ *
+ * Both binary and string values can be read, a string is returned without its terminator and a typed value in native form.
+ * On a miss the value is loaded from NVM with k_dbm_get_blob_f, or with k_dbm_get_f if it is not configured. A typed
+ * record read from NVM is decoded and cached with its type, so it reads the same whether it was cached or not.
+ *
+ * @param key_p Key of the value to retrieve
+ * @param buffer_p Buffer receiving the value
+ * @param buffer_size Size of the buffer
+ * @param data_len_p Receives the length of the value, also when the buffer is too small
+ *
+ * @return Returns 0 on success, -1 otherwise
+ */
+int k_dbm_get_blob(const char *key_p, void *buffer_p, size_t buffer_size, size_t *data_len_p);
+
+/**
+ * @brief Insert a typed value into the DB
+ *
+ * The value is kept in native binary form, so the typed getters read it without any string parsing.
+ * In NVM it is saved with k_dbm_insert_blob_f as a NULL tag byte and a type byte followed by the value in little endian order,
+ * the insert fails if k_dbm_insert_blob_f is not configured.
+ *
+ * @param key_p Entry key
+ * @param value Entry value
+ * @param storage Storage where the pair will be saved
+ * @return 0 in case of success, -1 otherwise
+ */
+int k_dbm_set_i32(const char *key_p, int32_t value, k_dbm_storage_t storage);
+int k_dbm_set_u64(const char *key_p, uint64_t value, k_dbm_storage_t storage);
+int k_dbm_set_f32(const char *key_p, float value, k_dbm_storage_t storage);
+int k_dbm_set_bool(const char *key_p, bool value, k_dbm_storage_t storage);
+
+/**
+ * @brief Get a typed value by key
+ *
+ * The value must have been saved with the setter of the same type. On a miss it is loaded from NVM with k_dbm_get_blob_f.
+ *
+ * @param key_p Key of the value to retrieve
+ * @param value_p Receives the value
+ *
+ * @return Returns 0 on success, -1 otherwise (including a value of another type)
+ */
+int k_dbm_get_i32(const char *key_p, int32_t *value_p);
+int k_dbm_get_u64(const char *key_p, uint64_t *value_p);
+int k_dbm_get_f32(const char *key_p, float *value_p);
+int k_dbm_get_bool(const char *key_p, bool *value_p);
+
+/**
+ * @brief Add a delta to an integer value, as a single operation
+ *
+ * The value is read, updated and stored back in place under one mutex acquisition, so concurrent
+ * increments are never lost. The value is an int32_t, a uint64_t or a decimal string (kept as a string
+ * within the int64_t range), on a miss it is loaded from NVM first. A missing key is not created, the counter
+ * must be set first with k_dbm_set_i32, k_dbm_set_u64 or k_dbm_insert in the storage it is to be kept in.
+ *
+ * @param key_p Key of the value
+ * @param delta Value to add, may be negative
+ * @param new_value_p Optional, receives the updated value. A u64 value above INT64_MAX is reported as INT64_MAX
+ * @param defer_persist For a NVM entry, true to only update the RAM copy and leave it to k_dbm_flush to save it
+ *
+ * @return Returns 0 on success, -1 otherwise (including a key not found, a non decimal string, or a result out of the range of the value type, the value is then unchanged)
+ */
+int k_dbm_increment(const char *key_p, int64_t delta, int64_t *new_value_p, bool defer_persist);
+
+/**
+ * @brief Save in NVM every value whose persistence has been deferred
+ *
+ * Each value is copied with the mutex held and written to NVM without it, a value written meanwhile is saved
+ * again and a delete of the key is repeated. Values of keys longer than K_DBM_FLUSH_KEY_MAX_LENGTH are written
+ * with the mutex held, one per mutex acquisition.
+ *
+ * @return Returns 0 on success, -1 if at least one value could not be saved, it is kept for the next flush
+ */
+int k_dbm_flush(void);
+
+/**
+ * @brief Start the flush due by the write-back thresholds or the coalescing windows, if any
+ *
+ * Thresholds are checked by every write, call this function periodically so the last deferred
+ * values are saved when the writes stop. The flush runs through k_dbm_run_async_f when configured.
+ *
+ * @return Returns 0 on success, -1 if the flush ran in the caller thread and at least one value could not be saved
+ */
+int k_dbm_poll(void);
+
+/**
+ * @brief Save every deferred value before exit
+ *
+ * NVM writes are no longer deferred afterwards, in write-back mode too, so nothing is left unsaved until the next k_dbm_init.
+ *
+ * @return Returns 0 on success, -1 if at least one value could not be saved, it is kept for a new call
+ */
+int k_dbm_shutdown(void);
+
+/**
+ * @brief Get the value of a key of the compile-time key registry
+ *
+ * @param key_id Key identifier from the generated k_dbm_keys.h (K_DBM_KEY_...)
+ * @param value_buffer_p Pointer to a variable where the retrieved value will be stored
+ * @param value_buffer_size Size of the buffer to store the value
+ *
+ * @return Returns 0 on success, -1 otherwise (including an unknown key_id)
+ */
+int k_dbm_get_by_id(size_t key_id, char *value_buffer_p, size_t value_buffer_size);
+
 /**
  * @brief Delete a key-value pair from the database
  *
@@ -158,10 +437,86 @@ int k_dbm_get(const char *key_p, char *value_buffer_p, size_t value_buffer_size)
  */
 int k_dbm_delete(const char *key_p);
 
+/**
+ * @brief Enumerate the entries whose key starts with a prefix
+ *
+ * Entries are reported in lexicographic key order under a single mutex acquisition. The ordered index
+ * makes the scan O(log n + k) for k matching entries.
+ * @note Only entries resident in RAM are reported, NVM entries that have not been cached yet are not.
+ *
+ * @param prefix_p Key prefix, an empty prefix reports every entry
+ * @param callback_f Callback invoked for every matching entry
+ * @param ctx_p User context passed to the callback
+ *
+ * @return Returns 0 on success, -1 otherwise
+ */
+int k_dbm_scan_prefix(const char *prefix_p, k_dbm_scan_cb_t callback_f, void *ctx_p);
+
+/**
+ * @brief Delete every entry whose key starts with a prefix
+ *
+ * The whole subtree is removed under a single mutex acquisition. If k_dbm_delete_prefix_f is configured,
+ * NVM is cleaned with one call to it, which also removes NVM keys that are not cached in RAM.
+ * Otherwise k_dbm_delete_f is called for every cached NVM entry under the prefix, then for every other NVM key under
+ * the prefix reported by k_dbm_enumerate_f, from its callback. Without either backend function the NVM keys that
+ * were never cached cannot be found and are left in NVM.
+ *
+ * @param prefix_p Key prefix
+ *
+ * @return Returns 0 on success, -1 otherwise. On a NVM failure the entries that could not be removed from NVM are kept.
+ *         Returns -2 if every cached entry has been deleted but neither k_dbm_delete_prefix_f nor k_dbm_enumerate_f
+ *         is configured, so uncached NVM keys under the prefix may remain.
+ */
+int k_dbm_delete_prefix(const char *prefix_p);
+
+/**
+ * @brief Preload NVM values into the RAM cache
+ *
+ * Listed keys are read in batches with k_dbm_get_batch_f when configured, without holding the mutex. Otherwise each
+ * key is read with k_dbm_get_f under its own mutex acquisition, so readers are only held for one NVM read at a time.
+ * The warm-up stops when the DB is full, it never evicts cached entries.
+ * If k_dbm_run_async_f is configured the warm-up runs in the background and the call returns at once. keys_p is not
+ * copied: the array and every string it points to must then stay valid until the background job has completed,
+ * e.g. a static array of string literals, never a local array of the caller.
+ *
+ * @param keys_p Keys to load, their pointers are stored by the cache like with k_dbm_get and must stay valid.
+ *               NULL to load every key reported by k_dbm_enumerate_f, which requires the key arena (K_DBM_KEY_ARENA_SIZE)
+ * @param key_count Number of keys of keys_p
+ *
+ * @return Returns 0 if the warm-up has been run or scheduled, -1 otherwise (including a warm-up already in progress)
+ */
+int k_dbm_warmup(const char *const *keys_p, size_t key_count);
+
+/**
+ * @brief Load the keys missing from the RAM cache from NVM, ahead of their use
+ *
+ * Keys already cached or known to be absent are skipped. The others are read in batches with k_dbm_get_batch_f
+ * when configured, with k_dbm_get_f otherwise, and cached like on a k_dbm_get miss (evicting a clean NVM entry
+ * if the DB is full). If k_dbm_run_async_f is configured the call returns at once and the keys are loaded in the background.
+ * keys_p is not copied: the array and every string it points to must then stay valid until the background job has
+ * completed, e.g. a static array of string literals, never a local array of the caller.
+ *
+ * @param keys_p Keys to load, their pointers are stored by the cache like with k_dbm_get and must stay valid
+ * @param key_count Number of keys of keys_p
+ *
+ * @return Returns 0 if the prefetch has been run or scheduled, -1 otherwise (including a prefetch already in progress)
+ */
+int k_dbm_prefetch(const char *const *keys_p, size_t key_count);
+
+/**
+ * @brief Get the cache statistics
+ *
+ * @param stats_p Receives a snapshot of the statistics
+ *
+ * @return Returns 0 on success, -1 otherwise
+ */
+int k_dbm_get_stats(k_dbm_stats_t *stats_p);
+
 /**
  * @brief Get the free space in the database
  *
  * This function returns the number of free entries available in the database.
+ * The count is kept up to date by insert and delete, so the call runs in constant time under the DB mutex.
  *
  * @return Returns the number of free entries in the database
  */
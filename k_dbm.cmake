@@ -2,6 +2,14 @@ cmake_minimum_required(VERSION 3.10)
 
 set(sources
     ${CMAKE_CURRENT_LIST_DIR}/src/k_dbm.c
+    ${CMAKE_CURRENT_LIST_DIR}/src/k_dbm_admission.c
+    ${CMAKE_CURRENT_LIST_DIR}/src/k_dbm_arena.c
+    ${CMAKE_CURRENT_LIST_DIR}/src/k_dbm_eviction.c
+    ${CMAKE_CURRENT_LIST_DIR}/src/k_dbm_index.c
+    ${CMAKE_CURRENT_LIST_DIR}/src/k_dbm_negative_cache.c
+    ${CMAKE_CURRENT_LIST_DIR}/src/k_dbm_nvm_filter.c
+    ${CMAKE_CURRENT_LIST_DIR}/src/k_dbm_slab.c
+    ${CMAKE_CURRENT_LIST_DIR}/src/k_dbm_value.c
     )
 
 set(public_includes
@@ -52,4 +60,45 @@ function (k_dbm_create_mock_library)
     add_library(k_dbm_mock ${CMAKE_CURRENT_LIST_DIR}/mock/k_dbm_mock.c)
     target_include_directories(k_dbm_mock PUBLIC ${CMAKE_CURRENT_LIST_DIR}/include)
     target_include_directories(k_dbm_mock PRIVATE ${CMAKE_CURRENT_LIST_DIR}/mock)
-endfunction()
\ No newline at end of file
+endfunction()
+
+# Generate k_dbm_keys.h in OUTPUT_DIR from a key manifest (one key per line, lines starting with # are comments).
+# The header defines a K_DBM_KEY_<NAME> identifier per key, to be used with k_dbm_insert_by_id/k_dbm_get_by_id.
+# k_dbm sources must be built with OUTPUT_DIR in their include path and K_DBM_KEY_REGISTRY defined.
+function(k_dbm_generate_key_registry MANIFEST OUTPUT_DIR)
+    file(STRINGS ${MANIFEST} manifest_lines)
+    set(key_count 0)
+    set(key_strings "")
+    set(key_ids "")
+    set(key_names "")
+    foreach(line IN LISTS manifest_lines)
+        string(STRIP "${line}" key)
+        if (key STREQUAL "" OR key MATCHES "^#")
+            continue()
+        endif ()
+        string(MAKE_C_IDENTIFIER "${key}" key_name)
+        string(TOUPPER "${key_name}" key_name)
+        if (key_name IN_LIST key_names)
+            message(FATAL_ERROR "k_dbm: key '${key}' of ${MANIFEST} maps to an already used identifier K_DBM_KEY_${key_name}")
+        endif ()
+        list(APPEND key_names ${key_name})
+        string(REPLACE "\\" "\\\\" key "${key}")
+        string(REPLACE "\"" "\\\"" key "${key}")
+        string(APPEND key_strings "    \"${key}\", \\\n")
+        string(APPEND key_ids "\tK_DBM_KEY_${key_name} = ${key_count},\n")
+        math(EXPR key_count "${key_count} + 1")
+    endforeach()
+    if (key_count EQUAL 0)
+        message(FATAL_ERROR "k_dbm: key manifest ${MANIFEST} does not contain any key")
+    endif ()
+
+    set(header "/**\n * @brief Database Manager key registry, generated from ${MANIFEST}. Do not edit.\n * @addtogroup k_dbm\n * @{\n */\n#pragma once\n\n")
+    string(APPEND header "#define K_DBM_STATIC_KEY_COUNT ${key_count}\n\n")
+    string(APPEND header "#define K_DBM_STATIC_KEYS \\\n${key_strings}\n")
+    string(APPEND header "typedef enum\n{\n${key_ids}} k_dbm_key_id_t;\n\n/* @} */\n")
+
+    # Only touch the header when its content changes, so dependent sources are not rebuilt needlessly
+    file(WRITE ${OUTPUT_DIR}/k_dbm_keys.h.tmp "${header}")
+    configure_file(${OUTPUT_DIR}/k_dbm_keys.h.tmp ${OUTPUT_DIR}/k_dbm_keys.h COPYONLY)
+    set_property(DIRECTORY APPEND PROPERTY CMAKE_CONFIGURE_DEPENDS ${MANIFEST})
+endfunction()
@@ -17,3 +17,24 @@ DEFINE_FAKE_VALUE_FUNC(int, k_dbm_init, const k_dbm_config_t *)
 DEFINE_FAKE_VALUE_FUNC(int, k_dbm_insert, const char *, const char *, k_dbm_storage_t)
 DEFINE_FAKE_VALUE_FUNC(int, k_dbm_get, const char *, char *, size_t)
 DEFINE_FAKE_VALUE_FUNC(int, k_dbm_delete, const char *)
+DEFINE_FAKE_VALUE_FUNC(int, k_dbm_insert_by_id, size_t, const char *, k_dbm_storage_t)
+DEFINE_FAKE_VALUE_FUNC(int, k_dbm_get_by_id, size_t, char *, size_t)
+DEFINE_FAKE_VALUE_FUNC(int, k_dbm_scan_prefix, const char *, k_dbm_scan_cb_t, void *)
+DEFINE_FAKE_VALUE_FUNC(int, k_dbm_delete_prefix, const char *)
+DEFINE_FAKE_VALUE_FUNC(int, k_dbm_insert_blob, const char *, const void *, size_t, k_dbm_storage_t)
+DEFINE_FAKE_VALUE_FUNC(int, k_dbm_get_blob, const char *, void *, size_t, size_t *)
+DEFINE_FAKE_VALUE_FUNC(int, k_dbm_set_i32, const char *, int32_t, k_dbm_storage_t)
+DEFINE_FAKE_VALUE_FUNC(int, k_dbm_set_u64, const char *, uint64_t, k_dbm_storage_t)
+DEFINE_FAKE_VALUE_FUNC(int, k_dbm_set_f32, const char *, float, k_dbm_storage_t)
+DEFINE_FAKE_VALUE_FUNC(int, k_dbm_set_bool, const char *, bool, k_dbm_storage_t)
+DEFINE_FAKE_VALUE_FUNC(int, k_dbm_get_i32, const char *, int32_t *)
+DEFINE_FAKE_VALUE_FUNC(int, k_dbm_get_u64, const char *, uint64_t *)
+DEFINE_FAKE_VALUE_FUNC(int, k_dbm_get_f32, const char *, float *)
+DEFINE_FAKE_VALUE_FUNC(int, k_dbm_get_bool, const char *, bool *)
+DEFINE_FAKE_VALUE_FUNC(int, k_dbm_increment, const char *, int64_t, int64_t *, bool)
+DEFINE_FAKE_VALUE_FUNC(int, k_dbm_flush)
+DEFINE_FAKE_VALUE_FUNC(int, k_dbm_poll)
+DEFINE_FAKE_VALUE_FUNC(int, k_dbm_shutdown)
+DEFINE_FAKE_VALUE_FUNC(int, k_dbm_warmup, const char *const *, size_t)
+DEFINE_FAKE_VALUE_FUNC(int, k_dbm_prefetch, const char *const *, size_t)
+DEFINE_FAKE_VALUE_FUNC(int, k_dbm_get_stats, k_dbm_stats_t *)
@@ -23,6 +23,27 @@ DECLARE_FAKE_VALUE_FUNC(int, k_dbm_init, const k_dbm_config_t *)
 DECLARE_FAKE_VALUE_FUNC(int, k_dbm_insert, const char *, const char *, k_dbm_storage_t)
 DECLARE_FAKE_VALUE_FUNC(int, k_dbm_get, const char *, char *, size_t)
 DECLARE_FAKE_VALUE_FUNC(int, k_dbm_delete, const char *)
+DECLARE_FAKE_VALUE_FUNC(int, k_dbm_insert_by_id, size_t, const char *, k_dbm_storage_t)
+DECLARE_FAKE_VALUE_FUNC(int, k_dbm_get_by_id, size_t, char *, size_t)
+DECLARE_FAKE_VALUE_FUNC(int, k_dbm_scan_prefix, const char *, k_dbm_scan_cb_t, void *)
+DECLARE_FAKE_VALUE_FUNC(int, k_dbm_delete_prefix, const char *)
+DECLARE_FAKE_VALUE_FUNC(int, k_dbm_insert_blob, const char *, const void *, size_t, k_dbm_storage_t)
+DECLARE_FAKE_VALUE_FUNC(int, k_dbm_get_blob, const char *, void *, size_t, size_t *)
+DECLARE_FAKE_VALUE_FUNC(int, k_dbm_set_i32, const char *, int32_t, k_dbm_storage_t)
+DECLARE_FAKE_VALUE_FUNC(int, k_dbm_set_u64, const char *, uint64_t, k_dbm_storage_t)
+DECLARE_FAKE_VALUE_FUNC(int, k_dbm_set_f32, const char *, float, k_dbm_storage_t)
+DECLARE_FAKE_VALUE_FUNC(int, k_dbm_set_bool, const char *, bool, k_dbm_storage_t)
+DECLARE_FAKE_VALUE_FUNC(int, k_dbm_get_i32, const char *, int32_t *)
+DECLARE_FAKE_VALUE_FUNC(int, k_dbm_get_u64, const char *, uint64_t *)
+DECLARE_FAKE_VALUE_FUNC(int, k_dbm_get_f32, const char *, float *)
+DECLARE_FAKE_VALUE_FUNC(int, k_dbm_get_bool, const char *, bool *)
+DECLARE_FAKE_VALUE_FUNC(int, k_dbm_increment, const char *, int64_t, int64_t *, bool)
+DECLARE_FAKE_VALUE_FUNC(int, k_dbm_flush)
+DECLARE_FAKE_VALUE_FUNC(int, k_dbm_poll)
+DECLARE_FAKE_VALUE_FUNC(int, k_dbm_shutdown)
+DECLARE_FAKE_VALUE_FUNC(int, k_dbm_warmup, const char *const *, size_t)
+DECLARE_FAKE_VALUE_FUNC(int, k_dbm_prefetch, const char *const *, size_t)
+DECLARE_FAKE_VALUE_FUNC(int, k_dbm_get_stats, k_dbm_stats_t *)
 
 #ifdef __cplusplus
 }
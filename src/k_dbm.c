@@ -7,6 +7,7 @@
 /* Include -------------------------------------------------------------------*/
 #include "k_dbm.h"
 
+#include <inttypes.h>
 #include <stdio.h>
 #include <string.h>
 
@@ -15,7 +16,386 @@
 /* Macro ---------------------------------------------------------------------*/
 /* Typedef -------------------------------------------------------------------*/
 /* Function Declaration ------------------------------------------------------*/
+/**
+ * @brief Insert or update the value of an entry, DB mutex must be held
+ *
+ * @param db_index Index of the entry, -1 if the key is not in DB
+ * @param key_p Entry key
+ * @param key_len Length of the key
+ * @param hash Hash of the key
+ * @param bucket Free bucket returned by the lookup when db_index is -1
+ * @param value_p Value to store
+ * @param value_len Length of the value, terminator excluded
+ * @param value_type Type of the value
+ * @param storage Storage where the pair will be saved
+ *
+ * @return 0 in case of success, -1 otherwise
+ */
+static int k_dbm_write_locked(int db_index, const char *key_p, size_t key_len, uint32_t hash, size_t bucket, const void *value_p, size_t value_len,
+							  k_dbm_value_type_t value_type, k_dbm_storage_t storage);
+
+/**
+ * @brief Read the value of an entry, falling back to NVM and caching the result, DB mutex must be held
+ *
+ * @param db_index Index of the entry, -1 if the key is not in DB
+ * @param key_p Entry key
+ * @param key_len Length of the key
+ * @param hash Hash of the key
+ * @param bucket Free bucket returned by the lookup when db_index is -1
+ * @param value_buffer_p Buffer receiving the value
+ * @param value_buffer_size Size of the buffer
+ * @param value_type K_DBM_VALUE_TYPE_STRING to read a string with its terminator (typed values are formatted), K_DBM_VALUE_TYPE_BLOB to read any
+ *                   value as bytes, a typed value type to read a value of that type in native form
+ * @param value_len_p Receives the length of the value, terminator excluded, also when the buffer is too small
+ * @param is_hint 1 if the caller asked for the key to be cached, a value loaded from NVM bypasses the admission policy
+ *
+ * @return 0 in case of success, -1 otherwise
+ */
+static int k_dbm_read_locked(int db_index, const char *key_p, size_t key_len, uint32_t hash, size_t bucket, void *value_buffer_p, size_t value_buffer_size,
+							 k_dbm_value_type_t value_type, size_t *value_len_p, int is_hint);
+
+/**
+ * @brief Copy a value to the buffer of a reader in the requested form
+ *
+ * @param value_p Value as stored
+ * @param value_len Length of the value, terminator excluded
+ * @param stored_type Type of the value
+ * @param value_buffer_p Buffer receiving the value
+ * @param value_buffer_size Size of the buffer
+ * @param value_type Requested type, see k_dbm_read_locked
+ * @param value_len_p Receives the length of the value, terminator excluded, also when the buffer is too small
+ *
+ * @return 0 in case of success, -1 if the buffer is too small or the value cannot be read with the requested type
+ */
+static int k_dbm_read_value(const void *value_p, size_t value_len, k_dbm_value_type_t stored_type, void *value_buffer_p, size_t value_buffer_size,
+							k_dbm_value_type_t value_type, size_t *value_len_p);
+
+/**
+ * @brief Save a value in NVM with the callback matching its type, DB mutex must be held
+ *
+ * @param key_p Entry key
+ * @param value_p Value to save
+ * @param value_len Length of the value, terminator excluded
+ * @param value_type Type of the value
+ *
+ * @return 0 in case of success, -1 otherwise (including a binary value without k_dbm_insert_blob_f)
+ */
+static int k_dbm_nvm_write(const char *key_p, const void *value_p, size_t value_len, k_dbm_value_type_t value_type);
+
+/**
+ * @brief k_dbm_nvm_write without the NVM epoch update, does not need the DB mutex
+ *
+ * @param key_p Entry key
+ * @param value_p Value to save
+ * @param value_len Length of the value, terminator excluded
+ * @param value_type Type of the value
+ *
+ * @return 0 in case of success, -1 otherwise
+ */
+static int k_dbm_nvm_save(const char *key_p, const void *value_p, size_t value_len, k_dbm_value_type_t value_type);
+
+/**
+ * @brief Load a value from NVM with the callback matching the requested type
+ *
+ * Strings, and blobs without k_dbm_get_blob_f, are read with k_dbm_get_f. Blobs and typed values are read with
+ * k_dbm_get_blob_f. Whatever the requested type, a typed record is decoded and its own type is returned, so the
+ * value is cached in the form k_dbm_set_* stored it. Records are told apart by K_DBM_VALUE_RECORD_TAG.
+ *
+ * @param key_p Entry key
+ * @param value_buffer_p Buffer receiving the value
+ * @param value_buffer_size Size of the buffer
+ * @param value_type_p Requested type, receives the type of the value read
+ * @param value_len_p Receives the length of the value, terminator excluded
+ *
+ * @return 0 in case of success, -1 otherwise
+ */
+static int k_dbm_nvm_read(const char *key_p, void *value_buffer_p, size_t value_buffer_size, k_dbm_value_type_t *value_type_p, size_t *value_len_p);
+
+/**
+ * @brief Reload an empty string read from NVM as a typed record
+ *
+ * A typed value saved with k_dbm_insert_blob_f comes back from a string read cut at its record tag, as an empty
+ * string. An empty string is read again with k_dbm_get_blob_f, if configured, and decoded if it is a record.
+ *
+ * @param key_p Entry key
+ * @param value_buffer_p String read from NVM, replaced by the value in native form if it is a typed record
+ * @param value_type_p Receives the type of the value, left untouched if it is not a typed record
+ * @param value_len_p Length of the string, receives the length of the value
+ */
+static void k_dbm_nvm_read_record(const char *key_p, void *value_buffer_p, k_dbm_value_type_t *value_type_p, size_t *value_len_p);
+
+/**
+ * @brief Decode in place a typed record read from NVM with k_dbm_get_blob_f
+ *
+ * @param record_p Record, replaced by the value in native form. A blob saved with a second record tag loses it
+ * @param record_len_p Length of the record, receives the length of the value
+ * @param value_type_p Receives the type of the value
+ *
+ * @return 0 in case of success, -1 if the data is not a typed record
+ */
+static int k_dbm_nvm_decode(void *record_p, size_t *record_len_p, k_dbm_value_type_t *value_type_p);
+
+/**
+ * @brief Insert a typed value
+ *
+ * @param key_p Entry key
+ * @param value_p Value in native form
+ * @param value_type Type of the value
+ * @param storage Storage where the pair will be saved
+ *
+ * @return 0 in case of success, -1 otherwise
+ */
+static int k_dbm_set_typed(const char *key_p, const void *value_p, k_dbm_value_type_t value_type, k_dbm_storage_t storage);
+
+/**
+ * @brief Get a typed value
+ *
+ * @param key_p Entry key
+ * @param value_p Receives the value in native form
+ * @param value_type Type of the value
+ *
+ * @return 0 in case of success, -1 otherwise
+ */
+static int k_dbm_get_typed(const char *key_p, void *value_p, k_dbm_value_type_t value_type);
+
+/**
+ * @brief Add a delta to the integer value of an entry, DB mutex must be held
+ *
+ * @param db_index Index of the entry
+ * @param delta Value to add
+ * @param new_value_p Optional, receives the updated value
+ * @param defer_persist 1 to mark a NVM entry dirty instead of saving it
+ *
+ * @return 0 in case of success, -1 otherwise
+ */
+static int k_dbm_increment_locked(int db_index, int64_t delta, int64_t *new_value_p, int defer_persist);
+
+/**
+ * @brief Mark the value of an entry as newer than its NVM copy, or as saved
+ *
+ * @param db_index Index of the entry
+ * @param is_dirty 1 if the value still has to be saved in NVM
+ */
+static void k_dbm_set_dirty(int db_index, int is_dirty);
+
+/**
+ * @brief Start the coalescing window of a dirty entry, or restart it after a failed save
+ *
+ * @param db_index Index of the entry
+ */
+static void k_dbm_dirty_restart(int db_index);
+
+/**
+ * @brief Find the time at which the oldest dirty value has been written, DB mutex must be held
+ *
+ * @return Start of the oldest coalescing window, dirty_since_ms without a time source or dirty entry
+ */
+static uint32_t k_dbm_dirty_oldest_locked(void);
+
+/**
+ * @brief Record the new value of a NVM entry, DB mutex must be held
+ *
+ * @param db_index Index of the entry
+ * @param is_deferred 1 if the value has not been saved in NVM yet
+ */
+static void k_dbm_mark_written(int db_index, int is_deferred);
+
+/**
+ * @brief Check whether NVM writes are to be deferred
+ *
+ * @return 1 in write-back mode or with a coalescing window, until k_dbm_shutdown, 0 otherwise
+ */
+static int k_dbm_is_write_back(void);
+
+/**
+ * @brief Save in NVM the deferred values written at least min_age_ms ago
+ *
+ * @param min_age_ms Age of the values to save, 0 for all of them
+ *
+ * @return 0 in case of success, -1 if at least one value could not be saved
+ */
+static int k_dbm_flush_aged(uint32_t min_age_ms);
+
+/**
+ * @brief Save the next dirty entry in NVM, DB mutex must be held
+ *
+ * The value of a key shorter than K_DBM_FLUSH_KEY_MAX_LENGTH is copied into flush_save, for the caller to write it
+ * without holding the mutex and then call k_dbm_flush_end_locked. Other values are saved right away.
+ *
+ * @param position_p Entry to start from, receives the entry following the saved one, K_DBM_DB_SIZE once no dirty entry is left
+ * @param min_age_ms Age of the values to save, 0 for all of them
+ *
+ * @return 0 in case of success or if no dirty entry is left, -1 if the save failed, the entry is kept dirty,
+ *		   1 if the value has been copied into flush_save
+ */
+static int k_dbm_flush_next_locked(size_t *position_p, uint32_t min_age_ms);
+
+/**
+ * @brief Complete the write of flush_save, DB mutex must be held
+ *
+ * The entry is only marked as saved if its value has not been rewritten meanwhile, otherwise position_p is moved
+ * back so the new value is saved by the same flush. A delete of the key during the write is repeated, the write
+ * may have reached NVM after it.
+ *
+ * @param save_result Result of the NVM write
+ * @param position_p Next entry of the flush, may be moved back
+ *
+ * @return 0 in case of success, -1 otherwise
+ */
+static int k_dbm_flush_end_locked(int save_result, size_t *position_p);
+
+/**
+ * @brief Check whether a key is being written to NVM by a flush without holding the mutex, DB mutex must be held
+ *
+ * @param key_p Key to check
+ * @param key_len Length of the key
+ * @param hash Hash of the key
+ *
+ * @return 1 if the key is the one of flush_save, 0 otherwise
+ */
+static int k_dbm_is_flush_key(const char *key_p, size_t key_len, uint32_t hash);
+
+/**
+ * @brief Record a NVM delete that may hit the key being written by a flush, DB mutex must be held
+ *
+ * @param key_p Deleted key, or prefix of the deleted keys
+ * @param key_len Length of the key or of the prefix
+ * @param is_prefix 1 if every key starting with key_p has been deleted
+ */
+static void k_dbm_flush_key_deleted(const char *key_p, size_t key_len, int is_prefix);
+
+/**
+ * @brief Start a flush when a write-back threshold or the coalescing window is reached, in the background if k_dbm_run_async_f is configured
+ *
+ * @return 0 in case of success, -1 if the flush ran in the caller thread and failed
+ */
+static int k_dbm_write_back_poll(void);
+
+/**
+ * @brief Flush started by k_dbm_write_back_poll
+ *
+ * @return 0 in case of success, -1 otherwise
+ */
+static int k_dbm_flush_due(void);
+
+/**
+ * @brief k_dbm_flush_due run in the background
+ *
+ * @param ctx_p Unused
+ */
+static void k_dbm_flush_task(void *ctx_p);
+
+/**
+ * @brief Store a value read from NVM in the cache, evicting a clean NVM entry if the DB is full, DB mutex must be held
+ *
+ * @param db_index Index of the entry, -1 if the key is not in DB
+ * @param key_p Entry key
+ * @param key_len Length of the key
+ * @param hash Hash of the key
+ * @param bucket Free bucket returned by the lookup when db_index is -1
+ * @param value_p Value read from NVM
+ * @param value_len Length of the value, terminator excluded
+ * @param value_type Type of the value
+ * @param is_hint 1 if the caller asked for the key to be cached, an entry is evicted whatever the admission policy
+ */
+static void k_dbm_cache_locked(int db_index, const char *key_p, size_t key_len, uint32_t hash, size_t bucket, const void *value_p, size_t value_len,
+							   k_dbm_value_type_t value_type, int is_hint);
+
+/**
+ * @brief Reserve an entry for a new key, evicting a clean NVM entry if the DB is full, DB mutex must be held
+ *
+ * @param key_p Entry key
+ * @param key_len Length of the key
+ * @param hash Hash of the key
+ * @param storage Storage of the entry
+ * @param bucket Free bucket returned by the lookup
+ * @param is_hint 1 to evict an entry whatever the admission policy
+ *
+ * @return Index of the entry, -1 if the DB is full and no entry can be evicted
+ */
+static int k_dbm_alloc_or_evict(const char *key_p, size_t key_len, uint32_t hash, k_dbm_storage_t storage, size_t bucket, int is_hint);
+
+/**
+ * @brief k_dbm_enumerate_f callback of k_dbm_delete_prefix, deletes the uncached NVM keys under the prefix, DB mutex must be held
+ *
+ * @param key_p Key stored in NVM
+ * @param ctx_p Prefix to delete
+ *
+ * @return 0 to continue the enumeration
+ */
+static int k_dbm_delete_prefix_enumerate_cb(const char *key_p, void *ctx_p);
+
+/**
+ * @brief Schedule a load job, or run it in the caller thread if no background worker is available
+ *
+ * @param job_p Job to start
+ * @param keys_p Keys to load, NULL to enumerate the NVM keys
+ * @param key_count Number of keys of keys_p
+ *
+ * @return 0 if the job has been run or scheduled, -1 if it is already pending
+ */
+static int k_dbm_load_start(k_dbm_load_job_t *job_p, const char *const *keys_p, size_t key_count);
+
+/**
+ * @brief Load the keys of a job into the cache
+ *
+ * @param ctx_p Job to run
+ */
+static void k_dbm_load_task(void *ctx_p);
+
+/**
+ * @brief Load the keys of a job in batches with k_dbm_get_batch_f, NVM is read without holding the DB mutex
+ *
+ * @param job_p Job to run
+ */
+static void k_dbm_load_batches(const k_dbm_load_job_t *job_p);
+
+/**
+ * @brief k_dbm_enumerate_f callback of the load jobs
+ *
+ * @param key_p Key stored in NVM
+ * @param ctx_p Job to run
+ *
+ * @return 0 to continue, -1 once the DB is full
+ */
+static int k_dbm_load_enumerate_cb(const char *key_p, void *ctx_p);
+
+/**
+ * @brief Load a key into the cache, under its own mutex acquisition
+ *
+ * @param key_p Key to load
+ * @param is_warmup 1 to leave the key out once the DB is full instead of evicting an entry
+ *
+ * @return 0 to continue the job, -1 once the DB is full
+ */
+static int k_dbm_load_key(const char *key_p, int is_warmup);
+
+/**
+ * @brief Cache a value read by a load job, or remember that the key is missing from NVM, DB mutex must be held
+ *
+ * Single and batched loads both end here, so a key is cached the same way whatever the read. A load is not a client read:
+ * it is neither counted as a cache miss nor recorded by the admission sketch, which would otherwise favour keys nobody asked for.
+ *
+ * @param key_p Key read
+ * @param value_p String read from NVM, K_DBM_VALUE_MAX_LENGTH bytes, decoded in place if it is a typed record
+ * @param is_found 1 if the key has been read from NVM
+ */
+static void k_dbm_load_end_locked(const char *key_p, char *value_p, int is_found);
+
+/**
+ * @brief Check whether a key is neither cached nor known to be absent from NVM, DB mutex must be held
+ *
+ * @param key_p Key to check
+ *
+ * @return 1 if the key has to be read from NVM, 0 otherwise
+ */
+static int k_dbm_load_is_needed(const char *key_p);
+
 /* Constant ------------------------------------------------------------------*/
+#if K_DBM_STATIC_KEY_COUNT > 0
+static const char *const k_dbm_static_keys_a[K_DBM_STATIC_KEY_COUNT] = {K_DBM_STATIC_KEYS};
+#endif
+
 /* Variable ------------------------------------------------------------------*/
 k_dbm_context_t k_dbm_context = {0};
 
@@ -27,176 +407,1281 @@ int k_dbm_init(const k_dbm_config_t *config_p)
 	{
 		if (config_p->k_dbm_lock_mutex_f && config_p->k_dbm_unlock_mutex_f && config_p->k_dbm_insert_f && config_p->k_dbm_get_f && config_p->k_dbm_delete_f)
 		{
-			k_dbm_context.config	 = *config_p;
-			k_dbm_context.db.db_size = K_DBM_DB_SIZE;
-			ret_code				 = 0;
+			k_dbm_context.config = *config_p;
+			memset(&k_dbm_context.db, 0, sizeof(k_dbm_context.db));
+			k_dbm_context.db.db_size			  = K_DBM_DYNAMIC_DB_SIZE;
+			k_dbm_context.db.warmup_job.is_warmup = 1;
+			for (size_t i = 0; i < K_DBM_DYNAMIC_DB_SIZE; i++)
+			{
+				/* Lowest indexes on top of the stack, so the DB fills from the first entry */
+				k_dbm_context.db.free_slots_a[i] = (k_dbm_slot_t)(K_DBM_DYNAMIC_DB_SIZE - 1 - i);
+			}
+#if K_DBM_STATIC_KEY_COUNT > 0
+			for (size_t i = 0; i < K_DBM_STATIC_KEY_COUNT; i++)
+			{
+				/* Static keys own their entry and stay in the hash index, so the string API reaches them too */
+				k_dbm_entry_t *entry_p = &k_dbm_context.db.entries_a[K_DBM_STATIC_KEY_INDEX(i)];
+				size_t		   key_len = 0;
+				size_t		   bucket  = 0;
+				entry_p->key		   = k_dbm_static_keys_a[i];
+				entry_p->key_hash	   = k_dbm_hash_key(entry_p->key, &key_len);
+				entry_p->key_len	   = (uint32_t)key_len;
+				k_dbm_index_lookup(entry_p->key, key_len, entry_p->key_hash, &bucket);
+				k_dbm_index_insert(K_DBM_STATIC_KEY_INDEX(i), bucket);
+				k_dbm_ordered_insert(K_DBM_STATIC_KEY_INDEX(i));
+			}
+#endif
+#if K_DBM_KEY_ARENA_SIZE > 0
+			k_dbm_arena_init(&k_dbm_context.db.key_arena, k_dbm_context.db.key_arena_buffer_a, sizeof(k_dbm_context.db.key_arena_buffer_a));
+#endif
+#if K_DBM_VALUE_STORAGE == K_DBM_VALUE_STORAGE_ARENA
+			k_dbm_arena_init(&k_dbm_context.db.value_arena, k_dbm_context.db.value_arena_buffer_a, sizeof(k_dbm_context.db.value_arena_buffer_a));
+#elif K_DBM_VALUE_STORAGE == K_DBM_VALUE_STORAGE_SLAB
+			k_dbm_slab_init();
+#endif
+			k_dbm_nvm_filter_init();
+			ret_code = 0;
 		}
 	}
 	return ret_code;
 }
 
 int k_dbm_insert(const char *key_p, const char *value_p, k_dbm_storage_t storage)
+{
+	int			 ret_code  = -1;
+	const size_t value_len = value_p ? strlen(value_p) : K_DBM_VALUE_MAX_LENGTH;
+	if (key_p && value_len < K_DBM_VALUE_MAX_LENGTH && K_DBM_STORAGE_NONE != storage)
+	{
+		k_dbm_context.config.k_dbm_lock_mutex_f(K_DBM_LOCK_MUTEX_INFINITE_TIMEOUT);
+		size_t		   bucket	= 0;
+		size_t		   key_len	= 0;
+		const uint32_t hash		= k_dbm_hash_key(key_p, &key_len);
+		const int	   db_index = k_dbm_index_lookup(key_p, key_len, hash, &bucket);
+		ret_code				= k_dbm_write_locked(db_index, key_p, key_len, hash, bucket, value_p, value_len, K_DBM_VALUE_TYPE_STRING, storage);
+		k_dbm_context.config.k_dbm_unlock_mutex_f();
+		k_dbm_write_back_poll();
+	}
+	return ret_code;
+}
+
+int k_dbm_insert_blob(const char *key_p, const void *data_p, size_t data_len, k_dbm_storage_t storage)
 {
 	int ret_code = -1;
-	if (key_p && value_p && strlen(value_p) < K_DBM_VALUE_MAX_LENGTH && K_DBM_STORAGE_NONE != storage)
+	if (key_p && (data_p || 0 == data_len) && data_len < K_DBM_VALUE_MAX_LENGTH && K_DBM_STORAGE_NONE != storage)
 	{
 		k_dbm_context.config.k_dbm_lock_mutex_f(K_DBM_LOCK_MUTEX_INFINITE_TIMEOUT);
-		const int first_free_entry = k_dbm_find_first_empty_entry();
-		int		  db_index		   = k_dbm_find_entry(key_p);
-		if (-1 != db_index || -1 != first_free_entry)
-		{
-			/* Key is already present in DB, or we have space to insert a new key in it */
-			int save_success = 0;
-			switch (storage)
-			{
-				case K_DBM_STORAGE_NVM:
-					save_success = k_dbm_context.config.k_dbm_insert_f(key_p, value_p);
-					/* Fallthrough */
-				case K_DBM_STORAGE_RAM:
-					if (0 == save_success)
-					{
-						if (-1 != db_index)
-						{
-							/* Update existing entry */
-							k_dbm_context.db.entries_a[db_index].key = key_p;
-							strcpy(k_dbm_context.db.entries_a[db_index].value, value_p);
-							ret_code = 0;
-						}
-						else
-						{
-							/* Insert new entry */
-							k_dbm_context.db.entries_a[first_free_entry].key = key_p;
-							strcpy(k_dbm_context.db.entries_a[first_free_entry].value, value_p);
-							k_dbm_context.db.entries_a[first_free_entry].storage = storage;
-							ret_code											 = 0;
-						}
-					}
-					break;
-				default:
-					break;
-			}
-		}
+		size_t		   bucket	= 0;
+		size_t		   key_len	= 0;
+		const uint32_t hash		= k_dbm_hash_key(key_p, &key_len);
+		const int	   db_index = k_dbm_index_lookup(key_p, key_len, hash, &bucket);
+		ret_code				= k_dbm_write_locked(db_index, key_p, key_len, hash, bucket, data_p, data_len, K_DBM_VALUE_TYPE_BLOB, storage);
+		k_dbm_context.config.k_dbm_unlock_mutex_f();
+		k_dbm_write_back_poll();
+	}
+	return ret_code;
+}
+
+int k_dbm_insert_by_id(size_t key_id, const char *value_p, k_dbm_storage_t storage)
+{
+	int ret_code = -1;
+#if K_DBM_STATIC_KEY_COUNT > 0
+	const size_t value_len = value_p ? strlen(value_p) : K_DBM_VALUE_MAX_LENGTH;
+	if (key_id < K_DBM_STATIC_KEY_COUNT && value_len < K_DBM_VALUE_MAX_LENGTH && K_DBM_STORAGE_NONE != storage)
+	{
+		k_dbm_context.config.k_dbm_lock_mutex_f(K_DBM_LOCK_MUTEX_INFINITE_TIMEOUT);
+		const int			 db_index = K_DBM_STATIC_KEY_INDEX(key_id);
+		const k_dbm_entry_t *entry_p  = &k_dbm_context.db.entries_a[db_index];
+		ret_code					  = k_dbm_write_locked(db_index, entry_p->key, entry_p->key_len, entry_p->key_hash, 0, value_p, value_len, K_DBM_VALUE_TYPE_STRING, storage);
 		k_dbm_context.config.k_dbm_unlock_mutex_f();
+		k_dbm_write_back_poll();
 	}
+#else
+	(void)key_id;
+	(void)value_p;
+	(void)storage;
+#endif
 	return ret_code;
 }
 
 int k_dbm_get(const char *key_p, char *value_buffer_p, size_t value_buffer_size)
 {
-	int ret_code	 = -1;
-	int is_key_found = 0;
+	int ret_code = -1;
 	if (key_p && value_buffer_p)
 	{
 		k_dbm_context.config.k_dbm_lock_mutex_f(K_DBM_LOCK_MUTEX_INFINITE_TIMEOUT);
-		for (size_t i = 0; i < k_dbm_context.db.db_size; i++)
+		size_t		   bucket	 = 0;
+		size_t		   key_len	 = 0;
+		size_t		   value_len = 0;
+		const uint32_t hash		 = k_dbm_hash_key(key_p, &key_len);
+		const int	   db_index	 = k_dbm_index_lookup(key_p, key_len, hash, &bucket);
+		ret_code				 = k_dbm_read_locked(db_index, key_p, key_len, hash, bucket, value_buffer_p, value_buffer_size, K_DBM_VALUE_TYPE_STRING, &value_len, 0);
+		k_dbm_context.config.k_dbm_unlock_mutex_f();
+	}
+	return ret_code;
+}
+
+int k_dbm_get_blob(const char *key_p, void *buffer_p, size_t buffer_size, size_t *data_len_p)
+{
+	int ret_code = -1;
+	if (key_p && buffer_p && data_len_p)
+	{
+		k_dbm_context.config.k_dbm_lock_mutex_f(K_DBM_LOCK_MUTEX_INFINITE_TIMEOUT);
+		size_t		   bucket	= 0;
+		size_t		   key_len	= 0;
+		const uint32_t hash		= k_dbm_hash_key(key_p, &key_len);
+		const int	   db_index = k_dbm_index_lookup(key_p, key_len, hash, &bucket);
+		*data_len_p				= 0;
+		ret_code				= k_dbm_read_locked(db_index, key_p, key_len, hash, bucket, buffer_p, buffer_size, K_DBM_VALUE_TYPE_BLOB, data_len_p, 0);
+		k_dbm_context.config.k_dbm_unlock_mutex_f();
+	}
+	return ret_code;
+}
+
+int k_dbm_set_i32(const char *key_p, int32_t value, k_dbm_storage_t storage) { return k_dbm_set_typed(key_p, &value, K_DBM_VALUE_TYPE_I32, storage); }
+
+int k_dbm_set_u64(const char *key_p, uint64_t value, k_dbm_storage_t storage) { return k_dbm_set_typed(key_p, &value, K_DBM_VALUE_TYPE_U64, storage); }
+
+int k_dbm_set_f32(const char *key_p, float value, k_dbm_storage_t storage) { return k_dbm_set_typed(key_p, &value, K_DBM_VALUE_TYPE_F32, storage); }
+
+int k_dbm_set_bool(const char *key_p, bool value, k_dbm_storage_t storage)
+{
+	const uint8_t stored = value ? 1 : 0;
+	return k_dbm_set_typed(key_p, &stored, K_DBM_VALUE_TYPE_BOOL, storage);
+}
+
+int k_dbm_get_i32(const char *key_p, int32_t *value_p) { return k_dbm_get_typed(key_p, value_p, K_DBM_VALUE_TYPE_I32); }
+
+int k_dbm_get_u64(const char *key_p, uint64_t *value_p) { return k_dbm_get_typed(key_p, value_p, K_DBM_VALUE_TYPE_U64); }
+
+int k_dbm_get_f32(const char *key_p, float *value_p) { return k_dbm_get_typed(key_p, value_p, K_DBM_VALUE_TYPE_F32); }
+
+int k_dbm_get_bool(const char *key_p, bool *value_p)
+{
+	int		ret_code = -1;
+	uint8_t stored	 = 0;
+	if (value_p && 0 == (ret_code = k_dbm_get_typed(key_p, &stored, K_DBM_VALUE_TYPE_BOOL)))
+	{
+		*value_p = 0 != stored;
+	}
+	return ret_code;
+}
+
+int k_dbm_increment(const char *key_p, int64_t delta, int64_t *new_value_p, bool defer_persist)
+{
+	int ret_code = -1;
+	if (key_p)
+	{
+		k_dbm_context.config.k_dbm_lock_mutex_f(K_DBM_LOCK_MUTEX_INFINITE_TIMEOUT);
+		size_t		   bucket	= 0;
+		size_t		   key_len	= 0;
+		const uint32_t hash		= k_dbm_hash_key(key_p, &key_len);
+		int			   db_index = k_dbm_index_lookup(key_p, key_len, hash, &bucket);
+		if (-1 == db_index || K_DBM_STORAGE_NONE == k_dbm_context.db.entries_a[db_index].storage)
 		{
-			if (k_dbm_context.db.entries_a[i].key && 0 == strcmp(k_dbm_context.db.entries_a[i].key, key_p))
-			{
-				is_key_found = 1;
-				if (value_buffer_size > strlen(k_dbm_context.db.entries_a[i].value))
-				{
-					strcpy(value_buffer_p, k_dbm_context.db.entries_a[i].value);
-					ret_code = 0;
-				}
-				break;
-			}
+			/* Load the value from NVM as a string, a typed record is still cached with its own type */
+			uint64_t value	  = 0;
+			size_t	 read_len = 0;
+			k_dbm_read_locked(db_index, key_p, key_len, hash, bucket, &value, sizeof(value), K_DBM_VALUE_TYPE_STRING, &read_len, 1);
+			db_index = k_dbm_index_lookup(key_p, key_len, hash, &bucket);
 		}
-		if (!is_key_found)
+		if (-1 != db_index && K_DBM_STORAGE_NONE != k_dbm_context.db.entries_a[db_index].storage)
 		{
-			if (0 == k_dbm_context.config.k_dbm_get_f(key_p, value_buffer_p, value_buffer_size))
-			{
-				ret_code			 = 0;  // Key found in NVM
-				int first_free_entry = k_dbm_find_first_empty_entry();
-				if (-1 != first_free_entry)
-				{
-					/* Cache the value */
-					k_dbm_context.db.entries_a[first_free_entry].key = key_p;
-					strcpy(k_dbm_context.db.entries_a[first_free_entry].value, value_buffer_p);
-					k_dbm_context.db.entries_a[first_free_entry].storage = K_DBM_STORAGE_NVM;
-				}
-			}
+			ret_code = k_dbm_increment_locked(db_index, delta, new_value_p, defer_persist);
 		}
 		k_dbm_context.config.k_dbm_unlock_mutex_f();
+		k_dbm_write_back_poll();
 	}
 	return ret_code;
 }
 
-int k_dbm_delete(const char *key_p)
+int k_dbm_flush(void) { return k_dbm_flush_aged(0); }
+
+int k_dbm_poll(void) { return k_dbm_write_back_poll(); }
+
+int k_dbm_shutdown(void)
+{
+	k_dbm_context.config.k_dbm_lock_mutex_f(K_DBM_LOCK_MUTEX_INFINITE_TIMEOUT);
+	k_dbm_context.db.is_shut_down = 1;
+	k_dbm_context.config.k_dbm_unlock_mutex_f();
+	return k_dbm_flush();
+}
+
+int k_dbm_warmup(const char *const *keys_p, size_t key_count)
 {
 	int ret_code = -1;
-	if (key_p)
+	/* Enumerated keys only live during the callback, the cache can only keep an owned copy of them */
+	if (keys_p || (k_dbm_context.config.k_dbm_enumerate_f && K_DBM_KEY_ARENA_SIZE > 0))
+	{
+		ret_code = k_dbm_load_start(&k_dbm_context.db.warmup_job, keys_p, key_count);
+	}
+	return ret_code;
+}
+
+int k_dbm_prefetch(const char *const *keys_p, size_t key_count)
+{
+	int ret_code = -1;
+	if (keys_p)
+	{
+		ret_code = k_dbm_load_start(&k_dbm_context.db.prefetch_job, keys_p, key_count);
+	}
+	return ret_code;
+}
+
+int k_dbm_get_stats(k_dbm_stats_t *stats_p)
+{
+	int ret_code = -1;
+	if (stats_p)
 	{
 		k_dbm_context.config.k_dbm_lock_mutex_f(K_DBM_LOCK_MUTEX_INFINITE_TIMEOUT);
-		for (size_t i = 0; i < k_dbm_context.db.db_size; i++)
-		{
-			if (k_dbm_context.db.entries_a[i].key && 0 == strcmp(k_dbm_context.db.entries_a[i].key, key_p))
-			{
-				int is_deleted = 1;
-				switch (k_dbm_context.db.entries_a[i].storage)
-				{
-					case K_DBM_STORAGE_NVM:
-						if (0 != k_dbm_context.config.k_dbm_delete_f(key_p))
-						{
-							is_deleted = 0;	 // Deletion from NVM failed
-						}
-					/* Fallthrough */
-					case K_DBM_STORAGE_RAM:
-						if (is_deleted)
-						{
-							k_dbm_context.db.entries_a[i].storage = K_DBM_STORAGE_NONE;
-							k_dbm_context.db.entries_a[i].key	  = NULL;
-							memset(k_dbm_context.db.entries_a[i].value, 0, sizeof(k_dbm_context.db.entries_a[i].value));
-							ret_code = 0;
-						}
-						break;
-					default:
-						break;
-				}
-				break;
-			}
-		}
+		*stats_p = k_dbm_context.db.stats;
 		k_dbm_context.config.k_dbm_unlock_mutex_f();
+		ret_code = 0;
 	}
 	return ret_code;
 }
 
-size_t k_dbm_get_free_space(void)
+int k_dbm_get_by_id(size_t key_id, char *value_buffer_p, size_t value_buffer_size)
 {
-	size_t free_count = 0;
-	for (size_t i = 0; i < k_dbm_context.db.db_size; i++)
+	int ret_code = -1;
+#if K_DBM_STATIC_KEY_COUNT > 0
+	if (key_id < K_DBM_STATIC_KEY_COUNT && value_buffer_p)
 	{
-		if (K_DBM_STORAGE_NONE == k_dbm_context.db.entries_a[i].storage)
-		{
-			free_count++;
-		}
+		k_dbm_context.config.k_dbm_lock_mutex_f(K_DBM_LOCK_MUTEX_INFINITE_TIMEOUT);
+		const int			 db_index  = K_DBM_STATIC_KEY_INDEX(key_id);
+		const k_dbm_entry_t *entry_p   = &k_dbm_context.db.entries_a[db_index];
+		size_t				 value_len = 0;
+		ret_code = k_dbm_read_locked(db_index, entry_p->key, entry_p->key_len, entry_p->key_hash, 0, value_buffer_p, value_buffer_size, K_DBM_VALUE_TYPE_STRING,
+									 &value_len, 0);
+		k_dbm_context.config.k_dbm_unlock_mutex_f();
 	}
-	return free_count;
+#else
+	(void)key_id;
+	(void)value_buffer_p;
+	(void)value_buffer_size;
+#endif
+	return ret_code;
 }
 
-int k_dbm_find_first_empty_entry(void)
+int k_dbm_delete(const char *key_p)
 {
 	int ret_code = -1;
-	for (size_t i = 0; i < k_dbm_context.db.db_size; i++)
+	if (key_p)
 	{
-		if (K_DBM_STORAGE_NONE == k_dbm_context.db.entries_a[i].storage)
+		k_dbm_context.config.k_dbm_lock_mutex_f(K_DBM_LOCK_MUTEX_INFINITE_TIMEOUT);
+		const int db_index = k_dbm_find_entry(key_p);
+		if (-1 != db_index)
 		{
-			ret_code = (int)i;
-			break;
+			int is_deleted = 1;
+			switch (k_dbm_context.db.entries_a[db_index].storage)
+			{
+				case K_DBM_STORAGE_NVM:
+					k_dbm_context.db.nvm_epoch++;
+					if (0 != k_dbm_context.config.k_dbm_delete_f(key_p))
+					{
+						is_deleted = 0;	 // Deletion from NVM failed
+					}
+					else
+					{
+						k_dbm_nvm_filter_remove(k_dbm_context.db.entries_a[db_index].key_hash);
+						k_dbm_flush_key_deleted(key_p, k_dbm_context.db.entries_a[db_index].key_len, 0);
+					}
+				/* Fallthrough */
+				case K_DBM_STORAGE_RAM:
+					if (is_deleted)
+					{
+						k_dbm_free_entry(db_index);
+						ret_code = 0;
+					}
+					break;
+				default:
+					break;
+			}
 		}
+		k_dbm_context.config.k_dbm_unlock_mutex_f();
 	}
 	return ret_code;
 }
 
-int k_dbm_find_entry(const char *key_p)
+int k_dbm_delete_prefix(const char *prefix_p)
 {
-	int index = -1;
-	for (size_t i = 0; i < k_dbm_context.db.db_size; i++)
+	int ret_code = -1;
+	if (prefix_p)
 	{
-		if (k_dbm_context.db.entries_a[i].key && 0 == strcmp(k_dbm_context.db.entries_a[i].key, key_p))
+		k_dbm_context.config.k_dbm_lock_mutex_f(K_DBM_LOCK_MUTEX_INFINITE_TIMEOUT);
+		const size_t prefix_len	  = strlen(prefix_p);
+		const int	 is_batched	  = NULL != k_dbm_context.config.k_dbm_delete_prefix_f;
+		int			 is_nvm_clean = 1;
+		ret_code				  = 0;
+		k_dbm_context.db.nvm_epoch++;
+		if (is_batched && 0 != k_dbm_context.config.k_dbm_delete_prefix_f(prefix_p))
 		{
-			index = (int)i;
-			break;
+			is_nvm_clean = 0;  // Batched NVM deletion failed, keep the subtree untouched
+			ret_code	 = -1;
 		}
-	}
-	return index;
-}
\ No newline at end of file
+		else if (is_batched)
+		{
+			k_dbm_flush_key_deleted(prefix_p, prefix_len, 1);
+		}
+		size_t position = k_dbm_ordered_lower_bound(prefix_p, prefix_len);
+		while (is_nvm_clean && position < k_dbm_context.db.ordered_count)
+		{
+			const int			 db_index = (int)k_dbm_context.db.ordered_index_a[position];
+			const k_dbm_entry_t *entry_p  = &k_dbm_context.db.entries_a[db_index];
+			if (entry_p->key_len < prefix_len || 0 != memcmp(entry_p->key, prefix_p, prefix_len))
+			{
+				break;
+			}
+			int is_deleted = 1;
+			switch (entry_p->storage)
+			{
+				case K_DBM_STORAGE_NVM:
+					if (!is_batched && 0 != k_dbm_context.config.k_dbm_delete_f(entry_p->key))
+					{
+						is_deleted = 0;	 // Deletion from NVM failed
+						ret_code   = -1;
+					}
+					else
+					{
+						k_dbm_nvm_filter_remove(entry_p->key_hash);
+						k_dbm_flush_key_deleted(entry_p->key, entry_p->key_len, 0);
+					}
+				/* Fallthrough */
+				case K_DBM_STORAGE_RAM:
+					if (is_deleted)
+					{
+						k_dbm_free_entry(db_index);
+					}
+					break;
+				default:
+					is_deleted = 0;
+					break;
+			}
+			if (!is_deleted || K_DBM_IS_STATIC_ENTRY(db_index))
+			{
+				/* The entry is still in the ordered index */
+				position++;
+			}
+		}
+		if (!is_batched && k_dbm_context.config.k_dbm_enumerate_f)
+		{
+			/* NVM keys that were never cached are only known to the backend */
+			k_dbm_delete_prefix_ctx_t delete_ctx = {prefix_p, prefix_len, 0};
+			if (0 != k_dbm_context.config.k_dbm_enumerate_f(k_dbm_delete_prefix_enumerate_cb, &delete_ctx) || delete_ctx.is_failed)
+			{
+				ret_code = -1;
+			}
+		}
+		else if (!is_batched && 0 == ret_code)
+		{
+			ret_code = -2;	// Uncached NVM keys under the prefix may be left
+		}
+		k_dbm_context.config.k_dbm_unlock_mutex_f();
+	}
+	return ret_code;
+}
+
+static int k_dbm_delete_prefix_enumerate_cb(const char *key_p, void *ctx_p)
+{
+	k_dbm_delete_prefix_ctx_t *delete_ctx_p = ctx_p;
+	size_t					   key_len		= 0;
+	size_t					   bucket		= 0;
+	const uint32_t			   hash			= k_dbm_hash_key(key_p, &key_len);
+	if (key_len >= delete_ctx_p->prefix_len && 0 == memcmp(key_p, delete_ctx_p->prefix_p, delete_ctx_p->prefix_len))
+	{
+		const int db_index = k_dbm_index_lookup(key_p, key_len, hash, &bucket);
+		if (-1 != db_index && K_DBM_STORAGE_NONE != k_dbm_context.db.entries_a[db_index].storage)
+		{
+			/* Still cached, its NVM deletion has already failed */
+		}
+		else if (0 != k_dbm_context.config.k_dbm_delete_f(key_p))
+		{
+			delete_ctx_p->is_failed = 1;
+		}
+		else
+		{
+			k_dbm_nvm_filter_remove(hash);
+			k_dbm_flush_key_deleted(key_p, key_len, 0);
+		}
+	}
+	return 0;
+}
+
+int k_dbm_scan_prefix(const char *prefix_p, k_dbm_scan_cb_t callback_f, void *ctx_p)
+{
+	int ret_code = -1;
+	if (prefix_p && callback_f)
+	{
+		k_dbm_context.config.k_dbm_lock_mutex_f(K_DBM_LOCK_MUTEX_INFINITE_TIMEOUT);
+		const size_t prefix_len = strlen(prefix_p);
+		int			 is_stopped = 0;
+		/* Keys sharing the prefix are contiguous in the ordered index, starting from the prefix lower bound */
+		for (size_t position = k_dbm_ordered_lower_bound(prefix_p, prefix_len); position < k_dbm_context.db.ordered_count && !is_stopped; position++)
+		{
+			const int			 db_index = (int)k_dbm_context.db.ordered_index_a[position];
+			const k_dbm_entry_t *entry_p  = &k_dbm_context.db.entries_a[db_index];
+			if (entry_p->key_len < prefix_len || 0 != memcmp(entry_p->key, prefix_p, prefix_len))
+			{
+				break;
+			}
+			if (K_DBM_STORAGE_NONE != entry_p->storage)
+			{
+				is_stopped = callback_f(entry_p->key, k_dbm_value_get(db_index), k_dbm_value_length(db_index), ctx_p);
+			}
+		}
+		ret_code = 0;
+		k_dbm_context.config.k_dbm_unlock_mutex_f();
+	}
+	return ret_code;
+}
+
+size_t k_dbm_get_free_space(void)
+{
+	k_dbm_context.config.k_dbm_lock_mutex_f(K_DBM_LOCK_MUTEX_INFINITE_TIMEOUT);
+	const size_t free_count = k_dbm_context.db.db_size - k_dbm_context.db.db_count;
+	k_dbm_context.config.k_dbm_unlock_mutex_f();
+	return free_count;
+}
+
+int k_dbm_find_first_empty_entry(void)
+{
+	int ret_code = -1;
+	if (k_dbm_context.db.db_count < k_dbm_context.db.db_size)
+	{
+		ret_code = (int)k_dbm_context.db.free_slots_a[k_dbm_context.db.db_size - k_dbm_context.db.db_count - 1];
+	}
+	return ret_code;
+}
+
+int k_dbm_alloc_entry(const char *key_p, size_t key_len, uint32_t hash, k_dbm_storage_t storage, size_t bucket)
+{
+	int			db_index	 = k_dbm_find_first_empty_entry();
+	const char *stored_key_p = key_p;
+#if K_DBM_KEY_ARENA_SIZE > 0
+	if (-1 != db_index)
+	{
+		/* Keep an owned copy of the key, the caller buffer may be reused as soon as we return */
+		const uint32_t key_offset = k_dbm_arena_alloc(&k_dbm_context.db.key_arena, key_len + 1);
+		if (K_DBM_ARENA_INVALID_OFFSET != key_offset)
+		{
+			stored_key_p = memcpy(k_dbm_arena_ptr(&k_dbm_context.db.key_arena, key_offset), key_p, key_len + 1);
+		}
+		else
+		{
+			db_index = -1;	// Key arena is full
+		}
+	}
+#endif
+	if (-1 != db_index)
+	{
+		k_dbm_context.db.db_count++;
+		k_dbm_context.db.entries_a[db_index].key	  = stored_key_p;
+		k_dbm_context.db.entries_a[db_index].key_hash = hash;
+		k_dbm_context.db.entries_a[db_index].key_len  = (uint32_t)key_len;
+		k_dbm_context.db.entries_a[db_index].storage  = storage;
+		k_dbm_index_insert(db_index, bucket);
+		k_dbm_ordered_insert(db_index);
+	}
+	return db_index;
+}
+
+void k_dbm_free_entry(int db_index)
+{
+	k_dbm_context.db.entries_a[db_index].storage	   = K_DBM_STORAGE_NONE;
+	k_dbm_context.db.entries_a[db_index].is_referenced = 0;
+	k_dbm_set_dirty(db_index, 0);
+	k_dbm_value_clear(db_index);
+	if (!K_DBM_IS_STATIC_ENTRY(db_index))
+	{
+		k_dbm_index_remove(db_index);
+		k_dbm_ordered_remove(db_index);
+#if K_DBM_KEY_ARENA_SIZE > 0
+		const uint8_t *key_p = (const uint8_t *)k_dbm_context.db.entries_a[db_index].key;
+		k_dbm_arena_free(&k_dbm_context.db.key_arena, (uint32_t)(key_p - k_dbm_context.db.key_arena.buffer_p));
+#endif
+		k_dbm_context.db.entries_a[db_index].key	  = NULL;
+		k_dbm_context.db.entries_a[db_index].key_hash = 0;
+		k_dbm_context.db.entries_a[db_index].key_len  = 0;
+		k_dbm_context.db.db_count--;
+		k_dbm_context.db.free_slots_a[k_dbm_context.db.db_size - k_dbm_context.db.db_count - 1] = (k_dbm_slot_t)db_index;
+	}
+}
+
+static int k_dbm_write_locked(int db_index, const char *key_p, size_t key_len, uint32_t hash, size_t bucket, const void *value_p, size_t value_len,
+							  k_dbm_value_type_t value_type, k_dbm_storage_t storage)
+{
+	int		  ret_code	   = -1;
+	int		  is_new	   = 0;
+	int		  is_value_set = 0;
+	const int was_nvm	   = -1 != db_index && K_DBM_STORAGE_NVM == k_dbm_context.db.entries_a[db_index].storage;
+	/* The key being saved by a flush is deferred, written through it could be overwritten by the older flush copy */
+	const int is_flush_key = k_dbm_is_flush_key(key_p, key_len, hash);
+	/* The key is about to exist, a previous miss no longer holds */
+	k_dbm_negative_cache_remove(key_p, key_len, hash);
+	if (-1 == db_index)
+	{
+		/* Reserve the entry in the bucket found by the lookup, a write takes the place of a clean cached NVM entry if needed */
+		db_index = k_dbm_alloc_or_evict(key_p, key_len, hash, storage, bucket, 1);
+		is_new	 = 1;
+	}
+	else if (K_DBM_STORAGE_NONE == k_dbm_context.db.entries_a[db_index].storage)
+	{
+		/* Static key without value */
+		k_dbm_context.db.entries_a[db_index].storage = storage;
+		is_new										 = 1;
+	}
+	if (-1 != db_index)
+	{
+		/* Key is already present in DB, or we have space to insert a new key in it */
+		int save_success = 0;
+		switch (storage)
+		{
+			case K_DBM_STORAGE_NVM:
+				if (was_nvm && k_dbm_value_equals(db_index, value_p, value_len, value_type) &&
+					(!k_dbm_context.db.entries_a[db_index].is_dirty || k_dbm_is_write_back()))
+				{
+					/* NVM already holds the value, or will with the pending flush */
+					k_dbm_context.db.stats.writes_skipped++;
+					is_value_set = 1;
+				}
+				else if ((k_dbm_is_write_back() || is_flush_key) && (K_DBM_VALUE_TYPE_STRING == value_type || k_dbm_context.config.k_dbm_insert_blob_f) &&
+					0 == k_dbm_value_set(db_index, value_p, value_len, value_type))
+				{
+					/* Saved later, readers are not held for the NVM write */
+					k_dbm_mark_written(db_index, 1);
+					is_value_set = 1;
+				}
+				else if (is_flush_key)
+				{
+					save_success = -1;	// No room to defer the value
+				}
+				else if (0 == (save_success = k_dbm_nvm_write(key_p, value_p, value_len, value_type)))
+				{
+					/* NVM holds the new value, a deferred one is superseded */
+					k_dbm_mark_written(db_index, 0);
+				}
+				if (0 == save_success && !was_nvm)
+				{
+					/* Count the key once, an update of a cached NVM entry is already accounted */
+					k_dbm_nvm_filter_add(hash);
+				}
+				/* Fallthrough */
+			case K_DBM_STORAGE_RAM:
+				if (is_value_set || (0 == save_success && 0 == k_dbm_value_set(db_index, value_p, value_len, value_type)))
+				{
+					k_dbm_eviction_touch(db_index);
+					ret_code = 0;
+				}
+				else if (0 == save_success && K_DBM_STORAGE_NVM == storage)
+				{
+					/* Persisted but no room left to cache the value, drop the stale copy, the next read reloads it */
+					k_dbm_free_entry(db_index);
+					ret_code = 0;
+				}
+				else if (is_new)
+				{
+					/* Release the reserved entry */
+					k_dbm_free_entry(db_index);
+				}
+				break;
+			default:
+				break;
+		}
+	}
+	return ret_code;
+}
+
+static int k_dbm_read_locked(int db_index, const char *key_p, size_t key_len, uint32_t hash, size_t bucket, void *value_buffer_p, size_t value_buffer_size,
+							 k_dbm_value_type_t value_type, size_t *value_len_p, int is_hint)
+{
+	int ret_code = -1;
+	k_dbm_admission_record(hash);
+	if (-1 != db_index && K_DBM_STORAGE_NONE != k_dbm_context.db.entries_a[db_index].storage)
+	{
+		k_dbm_context.db.stats.cache_hits++;
+		k_dbm_eviction_touch(db_index);
+		ret_code = k_dbm_read_value(k_dbm_value_get(db_index), k_dbm_value_length(db_index), (k_dbm_value_type_t)k_dbm_context.db.entries_a[db_index].value_type,
+									value_buffer_p, value_buffer_size, value_type, value_len_p);
+	}
+	else
+	{
+		k_dbm_context.db.stats.cache_misses++;
+		/* Typed values can only be loaded from their NVM record */
+		/* A key being saved by a flush is only missing from the cache if it has been deleted meanwhile */
+		if ((!k_dbm_value_type_size(value_type) || k_dbm_context.config.k_dbm_get_blob_f) && k_dbm_nvm_filter_may_contain(hash) &&
+			!k_dbm_negative_cache_contains(key_p, key_len, hash) && !k_dbm_is_flush_key(key_p, key_len, hash))
+		{
+			/* Read the whole value whatever the size of the buffer, so it can be cached and decoded */
+			char			   value_a[K_DBM_VALUE_MAX_LENGTH] = {0};
+			k_dbm_value_type_t read_type					   = value_type;
+			size_t			   read_len						   = 0;
+			if (0 == k_dbm_nvm_read(key_p, value_a, sizeof(value_a), &read_type, &read_len))
+			{
+				/* Key found in NVM, cached with its stored type, then returned like a cached value */
+				k_dbm_cache_locked(db_index, key_p, key_len, hash, bucket, value_a, read_len, read_type, is_hint);
+				ret_code = k_dbm_read_value(value_a, read_len, read_type, value_buffer_p, value_buffer_size, value_type, value_len_p);
+			}
+			else if (0 == read_len)
+			{
+				/* Any storable value would have fit, remember the miss so the next read of this key does not reach NVM */
+				k_dbm_negative_cache_add(key_p, key_len, hash);
+			}
+			else
+			{
+				*value_len_p = read_len;
+			}
+		}
+	}
+	return ret_code;
+}
+
+static int k_dbm_read_value(const void *value_p, size_t value_len, k_dbm_value_type_t stored_type, void *value_buffer_p, size_t value_buffer_size,
+							k_dbm_value_type_t value_type, size_t *value_len_p)
+{
+	int			 ret_code		= -1;
+	const size_t terminator_len = K_DBM_VALUE_TYPE_STRING == value_type;  // Strings are returned with their terminator, blobs are not
+	/* Any value can be read as bytes, other types must match, except typed values that can be read as strings */
+	if (K_DBM_VALUE_TYPE_BLOB == value_type || stored_type == value_type)
+	{
+		*value_len_p = value_len;
+		if (value_buffer_size >= value_len + terminator_len)
+		{
+			memcpy(value_buffer_p, value_p, value_len + terminator_len);
+			ret_code = 0;
+		}
+	}
+	else if (K_DBM_VALUE_TYPE_STRING == value_type && k_dbm_value_type_size(stored_type))
+	{
+		ret_code = k_dbm_value_format(value_p, stored_type, value_buffer_p, value_buffer_size, value_len_p);
+	}
+	return ret_code;
+}
+
+static int k_dbm_nvm_write(const char *key_p, const void *value_p, size_t value_len, k_dbm_value_type_t value_type)
+{
+	k_dbm_context.db.nvm_epoch++;
+	return k_dbm_nvm_save(key_p, value_p, value_len, value_type);
+}
+
+static int k_dbm_nvm_save(const char *key_p, const void *value_p, size_t value_len, k_dbm_value_type_t value_type)
+{
+	int ret_code = -1;
+	if (K_DBM_VALUE_TYPE_STRING == value_type)
+	{
+		ret_code = k_dbm_context.config.k_dbm_insert_f(key_p, value_p);
+	}
+	else if (K_DBM_VALUE_TYPE_BLOB == value_type && k_dbm_context.config.k_dbm_insert_blob_f && value_len &&
+			 K_DBM_VALUE_RECORD_TAG == *(const uint8_t *)value_p)
+	{
+		/* Escaped with a second tag, so the blob cannot be taken for a typed record */
+		uint8_t escaped_a[K_DBM_VALUE_MAX_LENGTH];
+		escaped_a[0] = K_DBM_VALUE_RECORD_TAG;
+		memcpy(&escaped_a[1], value_p, value_len);
+		ret_code = k_dbm_context.config.k_dbm_insert_blob_f(key_p, escaped_a, value_len + 1);
+	}
+	else if (K_DBM_VALUE_TYPE_BLOB == value_type && k_dbm_context.config.k_dbm_insert_blob_f)
+	{
+		ret_code = k_dbm_context.config.k_dbm_insert_blob_f(key_p, value_p, value_len);
+	}
+	else if (k_dbm_context.config.k_dbm_insert_blob_f)
+	{
+		uint8_t record_a[K_DBM_VALUE_RECORD_MAX_LENGTH];
+		ret_code = k_dbm_context.config.k_dbm_insert_blob_f(key_p, record_a, k_dbm_value_encode(value_type, value_p, record_a));
+	}
+	return ret_code;
+}
+
+static int k_dbm_nvm_read(const char *key_p, void *value_buffer_p, size_t value_buffer_size, k_dbm_value_type_t *value_type_p, size_t *value_len_p)
+{
+	int ret_code = -1;
+	if (K_DBM_VALUE_TYPE_STRING == *value_type_p || (K_DBM_VALUE_TYPE_BLOB == *value_type_p && !k_dbm_context.config.k_dbm_get_blob_f))
+	{
+		*value_type_p = K_DBM_VALUE_TYPE_STRING;
+		if (0 == (ret_code = k_dbm_context.config.k_dbm_get_f(key_p, value_buffer_p, value_buffer_size)))
+		{
+			*value_len_p = strlen(value_buffer_p);
+			k_dbm_nvm_read_record(key_p, value_buffer_p, value_type_p, value_len_p);
+		}
+	}
+	else if (k_dbm_context.config.k_dbm_get_blob_f &&
+			 0 == (ret_code = k_dbm_context.config.k_dbm_get_blob_f(key_p, value_buffer_p, value_buffer_size, value_len_p)) &&
+			 0 != k_dbm_nvm_decode(value_buffer_p, value_len_p, value_type_p))
+	{
+		*value_type_p = K_DBM_VALUE_TYPE_BLOB;	// Not a typed record
+	}
+	return ret_code;
+}
+
+static void k_dbm_nvm_read_record(const char *key_p, void *value_buffer_p, k_dbm_value_type_t *value_type_p, size_t *value_len_p)
+{
+	uint8_t record_a[K_DBM_VALUE_RECORD_MAX_LENGTH];
+	size_t	record_len = 0;
+	if (k_dbm_context.config.k_dbm_get_blob_f && 0 == *value_len_p &&
+		0 == k_dbm_context.config.k_dbm_get_blob_f(key_p, record_a, sizeof(record_a), &record_len) && 0 == k_dbm_nvm_decode(record_a, &record_len, value_type_p))
+	{
+		memcpy(value_buffer_p, record_a, record_len);
+		*value_len_p = record_len;
+	}
+}
+
+static int k_dbm_nvm_decode(void *record_p, size_t *record_len_p, k_dbm_value_type_t *value_type_p)
+{
+	int		 ret_code = -1;
+	uint64_t value	  = 0;
+	uint8_t *data_p	  = record_p;
+	if (*record_len_p > 1 && K_DBM_VALUE_RECORD_TAG == data_p[0])
+	{
+		/* The tag is followed by the type of the value, or by the first byte of an escaped blob */
+		const k_dbm_value_type_t record_type = (k_dbm_value_type_t)data_p[1];
+		if (K_DBM_VALUE_RECORD_TAG == data_p[1])
+		{
+			*record_len_p -= 1;
+			memmove(data_p, &data_p[1], *record_len_p);
+		}
+		else if (0 == k_dbm_value_decode(data_p, *record_len_p, record_type, &value))
+		{
+			*record_len_p = k_dbm_value_type_size(record_type);
+			*value_type_p = record_type;
+			memcpy(record_p, &value, *record_len_p);
+			ret_code = 0;
+		}
+	}
+	return ret_code;
+}
+
+static int k_dbm_set_typed(const char *key_p, const void *value_p, k_dbm_value_type_t value_type, k_dbm_storage_t storage)
+{
+	int ret_code = -1;
+	if (key_p && K_DBM_STORAGE_NONE != storage)
+	{
+		k_dbm_context.config.k_dbm_lock_mutex_f(K_DBM_LOCK_MUTEX_INFINITE_TIMEOUT);
+		size_t		   bucket	= 0;
+		size_t		   key_len	= 0;
+		const uint32_t hash		= k_dbm_hash_key(key_p, &key_len);
+		const int	   db_index = k_dbm_index_lookup(key_p, key_len, hash, &bucket);
+		ret_code = k_dbm_write_locked(db_index, key_p, key_len, hash, bucket, value_p, k_dbm_value_type_size(value_type), value_type, storage);
+		k_dbm_context.config.k_dbm_unlock_mutex_f();
+		k_dbm_write_back_poll();
+	}
+	return ret_code;
+}
+
+static int k_dbm_get_typed(const char *key_p, void *value_p, k_dbm_value_type_t value_type)
+{
+	int ret_code = -1;
+	if (key_p && value_p)
+	{
+		k_dbm_context.config.k_dbm_lock_mutex_f(K_DBM_LOCK_MUTEX_INFINITE_TIMEOUT);
+		size_t		   bucket	 = 0;
+		size_t		   key_len	 = 0;
+		size_t		   value_len = 0;
+		const uint32_t hash		 = k_dbm_hash_key(key_p, &key_len);
+		const int	   db_index	 = k_dbm_index_lookup(key_p, key_len, hash, &bucket);
+		ret_code = k_dbm_read_locked(db_index, key_p, key_len, hash, bucket, value_p, k_dbm_value_type_size(value_type), value_type, &value_len, 0);
+		k_dbm_context.config.k_dbm_unlock_mutex_f();
+	}
+	return ret_code;
+}
+
+static int k_dbm_increment_locked(int db_index, int64_t delta, int64_t *new_value_p, int defer_persist)
+{
+	int						 ret_code	 = -1;
+	int						 is_in_range = 0;
+	int32_t					 i32_value	 = 0;
+	uint64_t				 u64_value	 = 0;
+	int64_t					 i64_value	 = 0;
+	const void				*value_p	 = NULL;
+	const k_dbm_entry_t		*entry_p	 = &k_dbm_context.db.entries_a[db_index];
+	const k_dbm_value_type_t value_type	 = (k_dbm_value_type_t)entry_p->value_type;
+	size_t					 value_len	 = k_dbm_value_type_size(value_type);
+	int64_t					 new_value	 = 0;
+	/* Long enough for any int64_t */
+	char string_a[sizeof("-9223372036854775808")] = {0};
+	if (K_DBM_VALUE_TYPE_I32 == value_type)
+	{
+		memcpy(&i32_value, k_dbm_value_get(db_index), sizeof(i32_value));
+		is_in_range = delta >= (int64_t)INT32_MIN - i32_value && delta <= (int64_t)INT32_MAX - i32_value;
+		i32_value	= is_in_range ? (int32_t)(i32_value + delta) : i32_value;
+		new_value	= i32_value;
+		value_p		= &i32_value;
+	}
+	else if (K_DBM_VALUE_TYPE_U64 == value_type)
+	{
+		memcpy(&u64_value, k_dbm_value_get(db_index), sizeof(u64_value));
+		/* Magnitude of a negative delta, INT64_MIN included */
+		const uint64_t magnitude = delta < 0 ? (uint64_t)(-(delta + 1)) + 1 : (uint64_t)delta;
+		is_in_range				 = delta < 0 ? magnitude <= u64_value : magnitude <= UINT64_MAX - u64_value;
+		u64_value				 = is_in_range ? (delta < 0 ? u64_value - magnitude : u64_value + magnitude) : u64_value;
+		new_value				 = u64_value > INT64_MAX ? INT64_MAX : (int64_t)u64_value;
+		value_p					 = &u64_value;
+	}
+	else if (K_DBM_VALUE_TYPE_STRING == value_type && 0 == k_dbm_value_parse_i64(k_dbm_value_get(db_index), entry_p->value_len, &i64_value))
+	{
+		/* Decimal string, e.g. a counter saved with k_dbm_insert, kept as a string */
+		is_in_range = delta < 0 ? i64_value >= INT64_MIN - delta : i64_value <= INT64_MAX - delta;
+		i64_value	= is_in_range ? i64_value + delta : i64_value;
+		new_value	= i64_value;
+		value_len	= (size_t)snprintf(string_a, sizeof(string_a), "%" PRId64, i64_value);
+		value_p		= string_a;
+	}
+	if (is_in_range)
+	{
+		const int is_nvm	   = K_DBM_STORAGE_NVM == entry_p->storage;
+		const int is_flush_key = k_dbm_is_flush_key(entry_p->key, entry_p->key_len, entry_p->key_hash);
+		int		  save_success = 0;
+		defer_persist		   = (defer_persist && !k_dbm_context.db.is_shut_down) || k_dbm_is_write_back() || is_flush_key;
+		if (is_nvm && !defer_persist)
+		{
+			save_success = k_dbm_nvm_write(entry_p->key, value_p, value_len, value_type);
+		}
+		/* A typed value is rewritten in place, a string may need a larger block */
+		if (0 == save_success && 0 == k_dbm_value_set(db_index, value_p, value_len, value_type))
+		{
+			if (is_nvm)
+			{
+				k_dbm_mark_written(db_index, defer_persist);
+			}
+			k_dbm_eviction_touch(db_index);
+			ret_code = 0;
+		}
+		else if (0 == save_success && is_nvm && !defer_persist)
+		{
+			/* Persisted but no room left to cache the value, drop the stale copy, the next read reloads it */
+			k_dbm_free_entry(db_index);
+			ret_code = 0;
+		}
+		if (0 == ret_code && new_value_p)
+		{
+			*new_value_p = new_value;
+		}
+	}
+	return ret_code;
+}
+
+static void k_dbm_set_dirty(int db_index, int is_dirty)
+{
+	k_dbm_entry_t *entry_p = &k_dbm_context.db.entries_a[db_index];
+	if (is_dirty && !entry_p->is_dirty)
+	{
+		k_dbm_dirty_restart(db_index);
+		if (0 == k_dbm_context.db.dirty_count++)
+		{
+			/* The first dirty value is the oldest one */
+			k_dbm_context.db.dirty_since_ms = k_dbm_context.db.dirty_since_a[db_index];
+		}
+	}
+	else if (!is_dirty && entry_p->is_dirty)
+	{
+		k_dbm_context.db.dirty_count--;
+	}
+	entry_p->is_dirty = (uint8_t)(0 != is_dirty);
+}
+
+static void k_dbm_dirty_restart(int db_index)
+{
+	if (k_dbm_context.config.k_dbm_get_time_ms_f)
+	{
+		k_dbm_context.db.dirty_since_a[db_index] = k_dbm_context.config.k_dbm_get_time_ms_f();
+	}
+}
+
+static uint32_t k_dbm_dirty_oldest_locked(void)
+{
+	uint32_t oldest_ms = k_dbm_context.db.dirty_since_ms;
+	if (k_dbm_context.db.dirty_count && k_dbm_context.config.k_dbm_get_time_ms_f)
+	{
+		const uint32_t now_ms = k_dbm_context.config.k_dbm_get_time_ms_f();
+		oldest_ms			  = now_ms;
+		for (size_t i = 0; i < K_DBM_DB_SIZE; i++)
+		{
+			/* Compared by age, right across a wrap around of the time */
+			if (k_dbm_context.db.entries_a[i].is_dirty && (uint32_t)(now_ms - k_dbm_context.db.dirty_since_a[i]) > (uint32_t)(now_ms - oldest_ms))
+			{
+				oldest_ms = k_dbm_context.db.dirty_since_a[i];
+			}
+		}
+	}
+	return oldest_ms;
+}
+
+static void k_dbm_mark_written(int db_index, int is_deferred)
+{
+	if (k_dbm_context.db.entries_a[db_index].is_dirty)
+	{
+		/* The previous value never reaches NVM */
+		k_dbm_context.db.stats.writes_coalesced++;
+	}
+	k_dbm_set_dirty(db_index, is_deferred);
+}
+
+static int k_dbm_is_write_back(void)
+{
+	const int is_coalescing = k_dbm_context.config.write_coalesce_ms && k_dbm_context.config.k_dbm_get_time_ms_f;
+	return (k_dbm_context.config.is_write_back || is_coalescing) && !k_dbm_context.db.is_shut_down;
+}
+
+static int k_dbm_flush_aged(uint32_t min_age_ms)
+{
+	int	   ret_code		= 0;
+	size_t failed_count = 0;
+	size_t position		= 0;
+	while (position < K_DBM_DB_SIZE)
+	{
+		/* One save per mutex acquisition, readers get in between two NVM writes */
+		k_dbm_context.config.k_dbm_lock_mutex_f(K_DBM_LOCK_MUTEX_INFINITE_TIMEOUT);
+		int save_result = k_dbm_flush_next_locked(&position, min_age_ms);
+		if (1 == save_result)
+		{
+			/* The copy is written without holding the mutex, readers and writers are not held for the NVM write */
+			const k_dbm_flush_save_t *save_p = &k_dbm_context.db.flush_save;
+			k_dbm_context.config.k_dbm_unlock_mutex_f();
+			save_result = k_dbm_nvm_save(save_p->key_a, save_p->value_a, save_p->value_len, (k_dbm_value_type_t)save_p->value_type);
+			k_dbm_context.config.k_dbm_lock_mutex_f(K_DBM_LOCK_MUTEX_INFINITE_TIMEOUT);
+			save_result = k_dbm_flush_end_locked(save_result, &position);
+		}
+		if (0 != save_result)
+		{
+			ret_code = -1;	// Kept dirty, retried by the next flush
+			failed_count++;
+		}
+		if (position >= K_DBM_DB_SIZE)
+		{
+			/* Back off, the values left dirty by a failed save wait for a whole threshold again instead of being retried by every write */
+			k_dbm_context.db.flush_failed_count = failed_count;
+			k_dbm_context.db.dirty_since_ms		= k_dbm_dirty_oldest_locked();
+		}
+		k_dbm_context.config.k_dbm_unlock_mutex_f();
+	}
+	return ret_code;
+}
+
+static int k_dbm_flush_next_locked(size_t *position_p, uint32_t min_age_ms)
+{
+	int			   ret_code = 0;
+	size_t		   position = *position_p;
+	const uint32_t now_ms	= min_age_ms ? k_dbm_context.config.k_dbm_get_time_ms_f() : 0;
+	/* Values more recent than min_age_ms are left to a later flush */
+	while (position < K_DBM_DB_SIZE && k_dbm_context.db.dirty_count &&
+		   (!k_dbm_context.db.entries_a[position].is_dirty || (uint32_t)(now_ms - k_dbm_context.db.dirty_since_a[position]) < min_age_ms))
+	{
+		position++;
+	}
+	if (position < K_DBM_DB_SIZE && k_dbm_context.db.dirty_count)
+	{
+		const k_dbm_entry_t		*entry_p	= &k_dbm_context.db.entries_a[position];
+		const k_dbm_value_type_t value_type = (k_dbm_value_type_t)entry_p->value_type;
+		const size_t			 value_len	= k_dbm_value_length((int)position);
+		k_dbm_flush_save_t		*save_p		= &k_dbm_context.db.flush_save;
+		if (k_dbm_is_flush_key(entry_p->key, entry_p->key_len, entry_p->key_hash))
+		{
+			/* Being written by another flush */
+		}
+		else if (!save_p->is_saving && entry_p->key_len < sizeof(save_p->key_a))
+		{
+			/* Strings are copied with their terminator */
+			memcpy(save_p->key_a, entry_p->key, entry_p->key_len);
+			memcpy(save_p->value_a, k_dbm_value_get((int)position), value_len + (K_DBM_VALUE_TYPE_STRING == value_type));
+			save_p->key_a[entry_p->key_len] = '\0';
+			save_p->key_len					= entry_p->key_len;
+			save_p->value_len				= value_len;
+			save_p->key_hash				= entry_p->key_hash;
+			save_p->db_index				= (int)position;
+			save_p->value_type				= entry_p->value_type;
+			save_p->is_saving				= 1;
+			save_p->is_deleted				= 0;
+			k_dbm_context.db.nvm_epoch++;
+			ret_code = 1;
+		}
+		else if (0 == k_dbm_nvm_write(entry_p->key, k_dbm_value_get((int)position), value_len, value_type))
+		{
+			k_dbm_set_dirty((int)position, 0);
+		}
+		else
+		{
+			k_dbm_dirty_restart((int)position);
+			ret_code = -1;
+		}
+		position++;
+	}
+	else
+	{
+		position = K_DBM_DB_SIZE;
+	}
+	*position_p = position;
+	return ret_code;
+}
+
+static int k_dbm_flush_end_locked(int save_result, size_t *position_p)
+{
+	int					ret_code = save_result;
+	k_dbm_flush_save_t *save_p	 = &k_dbm_context.db.flush_save;
+	/* A load that read NVM during the write drops its values */
+	k_dbm_context.db.nvm_epoch++;
+	save_p->is_saving = 0;
+	if (save_p->is_deleted)
+	{
+		/* The entry is gone, the write may have recreated the key in NVM after the delete */
+		size_t	  bucket   = 0;
+		const int db_index = k_dbm_index_lookup(save_p->key_a, save_p->key_len, save_p->key_hash, &bucket);
+		if (0 != k_dbm_context.config.k_dbm_delete_f(save_p->key_a))
+		{
+			ret_code = -1;
+		}
+		if (-1 != db_index && k_dbm_context.db.entries_a[db_index].is_dirty && (size_t)db_index < *position_p)
+		{
+			/* Written again after the delete, saved by this flush */
+			*position_p = (size_t)db_index;
+		}
+	}
+	else if (0 == save_result)
+	{
+		if (k_dbm_value_equals(save_p->db_index, save_p->value_a, save_p->value_len, (k_dbm_value_type_t)save_p->value_type))
+		{
+			k_dbm_set_dirty(save_p->db_index, 0);
+		}
+		else
+		{
+			/* Rewritten during the save, the new value is saved next */
+			*position_p = (size_t)save_p->db_index;
+		}
+	}
+	else
+	{
+		k_dbm_dirty_restart(save_p->db_index);
+	}
+	return ret_code;
+}
+
+static int k_dbm_is_flush_key(const char *key_p, size_t key_len, uint32_t hash)
+{
+	const k_dbm_flush_save_t *save_p = &k_dbm_context.db.flush_save;
+	return save_p->is_saving && save_p->key_hash == hash && save_p->key_len == key_len && 0 == memcmp(save_p->key_a, key_p, key_len);
+}
+
+static void k_dbm_flush_key_deleted(const char *key_p, size_t key_len, int is_prefix)
+{
+	k_dbm_flush_save_t *save_p = &k_dbm_context.db.flush_save;
+	if (save_p->is_saving && (is_prefix ? save_p->key_len >= key_len : save_p->key_len == key_len) && 0 == memcmp(save_p->key_a, key_p, key_len))
+	{
+		save_p->is_deleted = 1;
+	}
+}
+
+static int k_dbm_write_back_poll(void)
+{
+	int ret_code = 0;
+	int is_due	 = 0;
+	/* The configuration does not change after init, write-through setups do not take the mutex again */
+	if (k_dbm_context.config.is_write_back || k_dbm_context.config.write_coalesce_ms)
+	{
+		k_dbm_context.config.k_dbm_lock_mutex_f(K_DBM_LOCK_MUTEX_INFINITE_TIMEOUT);
+		if (k_dbm_is_write_back() && k_dbm_context.db.dirty_count && !k_dbm_context.db.is_flush_pending)
+		{
+			const uint32_t max_age_ms  = k_dbm_context.config.write_back_max_age_ms;
+			const uint32_t coalesce_ms = k_dbm_context.config.write_coalesce_ms;
+			const size_t   dirty_max   = k_dbm_context.config.write_back_dirty_max;
+			uint32_t	   age_ms	   = 0;
+			if (k_dbm_context.config.k_dbm_get_time_ms_f)
+			{
+				/* Unsigned difference, right across a wrap around of the time */
+				age_ms = (uint32_t)(k_dbm_context.config.k_dbm_get_time_ms_f() - k_dbm_context.db.dirty_since_ms);
+			}
+			is_due							  = dirty_max && k_dbm_context.db.dirty_count >= k_dbm_context.db.flush_failed_count + dirty_max;
+			is_due							  = is_due || (max_age_ms && age_ms >= max_age_ms);
+			k_dbm_context.db.flush_min_age_ms = is_due ? 0 : coalesce_ms;	// The coalescing window is closed for each value on its own
+			is_due							  = is_due || (coalesce_ms && age_ms >= coalesce_ms);
+			k_dbm_context.db.is_flush_pending = (uint8_t)is_due;
+		}
+		k_dbm_context.config.k_dbm_unlock_mutex_f();
+	}
+	if (is_due && (!k_dbm_context.config.k_dbm_run_async_f || 0 != k_dbm_context.config.k_dbm_run_async_f(k_dbm_flush_task, NULL)))
+	{
+		/* No background worker available, the caller saves the values */
+		ret_code = k_dbm_flush_due();
+	}
+	return ret_code;
+}
+
+static int k_dbm_flush_due(void)
+{
+	/* flush_min_age_ms is not written again while the flush is pending */
+	const int ret_code = k_dbm_flush_aged(k_dbm_context.db.flush_min_age_ms);
+	k_dbm_context.config.k_dbm_lock_mutex_f(K_DBM_LOCK_MUTEX_INFINITE_TIMEOUT);
+	k_dbm_context.db.is_flush_pending = 0;
+	k_dbm_context.config.k_dbm_unlock_mutex_f();
+	return ret_code;
+}
+
+static void k_dbm_flush_task(void *ctx_p)
+{
+	(void)ctx_p;
+	k_dbm_flush_due();
+}
+
+static void k_dbm_cache_locked(int db_index, const char *key_p, size_t key_len, uint32_t hash, size_t bucket, const void *value_p, size_t value_len,
+							   k_dbm_value_type_t value_type, int is_hint)
+{
+	if (-1 == db_index)
+	{
+		/* The NVM read does not touch the index, the bucket found by the lookup is still valid */
+		db_index = k_dbm_alloc_or_evict(key_p, key_len, hash, K_DBM_STORAGE_NVM, bucket, is_hint);
+	}
+	else
+	{
+		k_dbm_context.db.entries_a[db_index].storage = K_DBM_STORAGE_NVM;
+	}
+	if (-1 != db_index && 0 != k_dbm_value_set(db_index, value_p, value_len, value_type))
+	{
+		/* No room to cache the value, the entry would hold a stale one */
+		k_dbm_free_entry(db_index);
+	}
+}
+
+static int k_dbm_alloc_or_evict(const char *key_p, size_t key_len, uint32_t hash, k_dbm_storage_t storage, size_t bucket, int is_hint)
+{
+	int db_index = k_dbm_alloc_entry(key_p, key_len, hash, storage, bucket);
+	if (-1 == db_index && 0 == k_dbm_eviction_evict(hash, is_hint))
+	{
+		/* Removing the victim from the index may have moved the free bucket */
+		k_dbm_index_lookup(key_p, key_len, hash, &bucket);
+		db_index = k_dbm_alloc_entry(key_p, key_len, hash, storage, bucket);
+	}
+	return db_index;
+}
+
+static int k_dbm_load_start(k_dbm_load_job_t *job_p, const char *const *keys_p, size_t key_count)
+{
+	int ret_code = -1;
+	k_dbm_context.config.k_dbm_lock_mutex_f(K_DBM_LOCK_MUTEX_INFINITE_TIMEOUT);
+	if (!job_p->is_pending)
+	{
+		job_p->keys_p	  = keys_p;
+		job_p->key_count  = key_count;
+		job_p->is_pending = 1;
+		ret_code		  = 0;
+	}
+	k_dbm_context.config.k_dbm_unlock_mutex_f();
+	if (0 == ret_code && (!k_dbm_context.config.k_dbm_run_async_f || 0 != k_dbm_context.config.k_dbm_run_async_f(k_dbm_load_task, job_p)))
+	{
+		/* No background worker available, load from the caller thread */
+		k_dbm_load_task(job_p);
+	}
+	return ret_code;
+}
+
+static void k_dbm_load_task(void *ctx_p)
+{
+	k_dbm_load_job_t *job_p = ctx_p;
+	if (!job_p->keys_p)
+	{
+		k_dbm_context.config.k_dbm_enumerate_f(k_dbm_load_enumerate_cb, job_p);
+	}
+	else if (k_dbm_context.config.k_dbm_get_batch_f)
+	{
+		k_dbm_load_batches(job_p);
+	}
+	else
+	{
+		for (size_t i = 0; i < job_p->key_count && 0 == k_dbm_load_key(job_p->keys_p[i], job_p->is_warmup); i++)
+		{
+		}
+	}
+	k_dbm_context.config.k_dbm_lock_mutex_f(K_DBM_LOCK_MUTEX_INFINITE_TIMEOUT);
+	job_p->is_pending = 0;
+	k_dbm_context.config.k_dbm_unlock_mutex_f();
+}
+
+static void k_dbm_load_batches(const k_dbm_load_job_t *job_p)
+{
+	char		values_a[K_DBM_LOAD_BATCH_SIZE][K_DBM_VALUE_MAX_LENGTH];
+	const char *batch_keys_a[K_DBM_LOAD_BATCH_SIZE];
+	int			results_a[K_DBM_LOAD_BATCH_SIZE];
+	size_t		next	= 0;
+	int			is_full = 0;
+	while (next < job_p->key_count && !is_full)
+	{
+		size_t batch_count = 0;
+		k_dbm_context.config.k_dbm_lock_mutex_f(K_DBM_LOCK_MUTEX_INFINITE_TIMEOUT);
+		while (next < job_p->key_count && batch_count < K_DBM_LOAD_BATCH_SIZE)
+		{
+			const char *key_p = job_p->keys_p[next++];
+			if (key_p && k_dbm_load_is_needed(key_p))
+			{
+				batch_keys_a[batch_count++] = key_p;
+			}
+		}
+		const uint32_t nvm_epoch = k_dbm_context.db.nvm_epoch;
+		k_dbm_context.config.k_dbm_unlock_mutex_f();
+		if (batch_count && 0 == k_dbm_context.config.k_dbm_get_batch_f(batch_keys_a, batch_count, values_a[0], sizeof(values_a[0]), results_a))
+		{
+			k_dbm_context.config.k_dbm_lock_mutex_f(K_DBM_LOCK_MUTEX_INFINITE_TIMEOUT);
+			/* A write or a delete reaching NVM during the read may have made the values stale */
+			for (size_t i = 0; i < batch_count && nvm_epoch == k_dbm_context.db.nvm_epoch && !is_full; i++)
+			{
+				is_full = job_p->is_warmup && k_dbm_context.db.db_count >= k_dbm_context.db.db_size;
+				if (!is_full)
+				{
+					k_dbm_load_end_locked(batch_keys_a[i], values_a[i], 0 == results_a[i]);
+				}
+			}
+			k_dbm_context.config.k_dbm_unlock_mutex_f();
+		}
+	}
+}
+
+static int k_dbm_load_enumerate_cb(const char *key_p, void *ctx_p)
+{
+	const k_dbm_load_job_t *job_p = ctx_p;
+	return k_dbm_load_key(key_p, job_p->is_warmup);
+}
+
+static int k_dbm_load_key(const char *key_p, int is_warmup)
+{
+	int ret_code = -1;
+	k_dbm_context.config.k_dbm_lock_mutex_f(K_DBM_LOCK_MUTEX_INFINITE_TIMEOUT);
+	if (!is_warmup || k_dbm_context.db.db_count < k_dbm_context.db.db_size)
+	{
+		if (key_p && k_dbm_load_is_needed(key_p))
+		{
+			char value_a[K_DBM_VALUE_MAX_LENGTH] = {0};
+			k_dbm_load_end_locked(key_p, value_a, 0 == k_dbm_context.config.k_dbm_get_f(key_p, value_a, sizeof(value_a)));
+		}
+		ret_code = 0;
+	}
+	k_dbm_context.config.k_dbm_unlock_mutex_f();
+	return ret_code;
+}
+
+static void k_dbm_load_end_locked(const char *key_p, char *value_p, int is_found)
+{
+	size_t		   bucket	= 0;
+	size_t		   key_len	= 0;
+	const uint32_t hash		= k_dbm_hash_key(key_p, &key_len);
+	const int	   db_index = k_dbm_index_lookup(key_p, key_len, hash, &bucket);
+	if (-1 != db_index && K_DBM_STORAGE_NONE != k_dbm_context.db.entries_a[db_index].storage)
+	{
+		/* Another thread may have cached the key meanwhile, its copy is at least as recent */
+	}
+	else if (is_found)
+	{
+		value_p[K_DBM_VALUE_MAX_LENGTH - 1] = '\0';
+		/* Loads read strings, a typed value is decoded like on a single read */
+		k_dbm_value_type_t value_type = K_DBM_VALUE_TYPE_STRING;
+		size_t			   value_len  = strlen(value_p);
+		k_dbm_nvm_read_record(key_p, value_p, &value_type, &value_len);
+		k_dbm_cache_locked(db_index, key_p, key_len, hash, bucket, value_p, value_len, value_type, 1);
+	}
+	else
+	{
+		k_dbm_negative_cache_add(key_p, key_len, hash);
+	}
+}
+
+static int k_dbm_load_is_needed(const char *key_p)
+{
+	size_t		   bucket	= 0;
+	size_t		   key_len	= 0;
+	const uint32_t hash		= k_dbm_hash_key(key_p, &key_len);
+	const int	   db_index = k_dbm_index_lookup(key_p, key_len, hash, &bucket);
+	return (-1 == db_index || K_DBM_STORAGE_NONE == k_dbm_context.db.entries_a[db_index].storage) && k_dbm_nvm_filter_may_contain(hash) &&
+		   !k_dbm_negative_cache_contains(key_p, key_len, hash) && !k_dbm_is_flush_key(key_p, key_len, hash);
+}
@@ -0,0 +1,104 @@
+/**
+ * @file k_dbm_admission.c
+ * @ingroup k_dbm
+ * @{
+ */
+
+/* Include -------------------------------------------------------------------*/
+#include "k_dbm_priv.h"
+
+/* Macro ---------------------------------------------------------------------*/
+#define K_DBM_ADMISSION_COUNTER_MAX	 (0x0Fu)
+#define K_DBM_ADMISSION_DEPTH		 (4)
+#define K_DBM_ADMISSION_SAMPLE_SIZE	 (10u * K_DBM_ADMISSION_SKETCH_SIZE)
+
+/* Typedef -------------------------------------------------------------------*/
+/* Function Declaration ------------------------------------------------------*/
+#if K_DBM_ADMISSION_SKETCH_SIZE > 0
+static uint8_t k_dbm_admission_estimate(uint32_t hash);
+static size_t  k_dbm_admission_counter_index(uint32_t hash, uint32_t step, size_t i);
+static uint8_t k_dbm_admission_counter_get(size_t counter);
+static void	   k_dbm_admission_counter_set(size_t counter, uint8_t value);
+static void	   k_dbm_admission_halve(void);
+#endif
+
+/* Constant ------------------------------------------------------------------*/
+/* Variable ------------------------------------------------------------------*/
+/* Function Definition -------------------------------------------------------*/
+void k_dbm_admission_record(uint32_t hash)
+{
+#if K_DBM_ADMISSION_SKETCH_SIZE > 0
+	/* Conservative update, only the counters at the current estimate grow, which keeps overestimation low */
+	const uint8_t  estimate = k_dbm_admission_estimate(hash);
+	const uint32_t step		= k_dbm_hash_mix(hash) | 1u;
+	if (estimate < K_DBM_ADMISSION_COUNTER_MAX)
+	{
+		for (size_t i = 0; i < K_DBM_ADMISSION_DEPTH; i++)
+		{
+			const size_t counter = k_dbm_admission_counter_index(hash, step, i);
+			if (estimate == k_dbm_admission_counter_get(counter))
+			{
+				k_dbm_admission_counter_set(counter, estimate + 1);
+			}
+		}
+	}
+	if (++k_dbm_context.db.admission_samples >= K_DBM_ADMISSION_SAMPLE_SIZE)
+	{
+		k_dbm_admission_halve();
+	}
+#else
+	(void)hash;
+#endif
+}
+
+int k_dbm_admission_admit(uint32_t candidate_hash, uint32_t victim_hash)
+{
+	int ret_code = 1;
+#if K_DBM_ADMISSION_SKETCH_SIZE > 0
+	ret_code = k_dbm_admission_estimate(candidate_hash) > k_dbm_admission_estimate(victim_hash);
+#else
+	(void)candidate_hash;
+	(void)victim_hash;
+#endif
+	return ret_code;
+}
+
+#if K_DBM_ADMISSION_SKETCH_SIZE > 0
+static uint8_t k_dbm_admission_estimate(uint32_t hash)
+{
+	const uint32_t step		= k_dbm_hash_mix(hash) | 1u;
+	uint8_t		   estimate = K_DBM_ADMISSION_COUNTER_MAX;
+	for (size_t i = 0; i < K_DBM_ADMISSION_DEPTH; i++)
+	{
+		const uint8_t value = k_dbm_admission_counter_get(k_dbm_admission_counter_index(hash, step, i));
+		estimate			= value < estimate ? value : estimate;
+	}
+	return estimate;
+}
+
+static size_t k_dbm_admission_counter_index(uint32_t hash, uint32_t step, size_t i)
+{
+	return (size_t)((hash + (uint32_t)i * step) % K_DBM_ADMISSION_SKETCH_SIZE);
+}
+
+static uint8_t k_dbm_admission_counter_get(size_t counter)
+{
+	return (uint8_t)((k_dbm_context.db.admission_sketch_a[counter / 2] >> ((counter % 2) * 4)) & K_DBM_ADMISSION_COUNTER_MAX);
+}
+
+static void k_dbm_admission_counter_set(size_t counter, uint8_t value)
+{
+	const unsigned shift						   = (unsigned)(counter % 2) * 4;
+	k_dbm_context.db.admission_sketch_a[counter / 2] = (uint8_t)((k_dbm_context.db.admission_sketch_a[counter / 2] & ~(K_DBM_ADMISSION_COUNTER_MAX << shift)) | (value << shift));
+}
+
+static void k_dbm_admission_halve(void)
+{
+	/* Aging, both counters of a byte are halved at once */
+	for (size_t i = 0; i < sizeof(k_dbm_context.db.admission_sketch_a); i++)
+	{
+		k_dbm_context.db.admission_sketch_a[i] = (uint8_t)((k_dbm_context.db.admission_sketch_a[i] >> 1) & 0x77u);
+	}
+	k_dbm_context.db.admission_samples /= 2;
+}
+#endif
@@ -0,0 +1,156 @@
+/**
+ * @file k_dbm_arena.c
+ * @ingroup k_dbm
+ * @{
+ */
+
+/* Include -------------------------------------------------------------------*/
+#include <string.h>
+
+#include "k_dbm_priv.h"
+
+/* Macro ---------------------------------------------------------------------*/
+#define K_DBM_ARENA_ALIGN(size) (((size) + sizeof(uint32_t) - 1) & ~(sizeof(uint32_t) - 1))
+
+/* Typedef -------------------------------------------------------------------*/
+/**
+ * @brief Header placed in front of every arena block
+ */
+typedef struct
+{
+	uint32_t size;	//!< Block size, header included
+	uint32_t next;	//!< Offset of the next free block, only meaningful for free blocks
+} k_dbm_arena_block_t;
+
+/* Function Declaration ------------------------------------------------------*/
+static k_dbm_arena_block_t *k_dbm_arena_block(const k_dbm_arena_t *arena_p, uint32_t offset);
+
+/* Constant ------------------------------------------------------------------*/
+/* Variable ------------------------------------------------------------------*/
+/* Function Definition -------------------------------------------------------*/
+void k_dbm_arena_init(k_dbm_arena_t *arena_p, uint32_t *buffer_p, size_t buffer_size)
+{
+	arena_p->buffer_p  = (uint8_t *)buffer_p;
+	arena_p->size	   = (uint32_t)(buffer_size & ~(sizeof(uint32_t) - 1));
+	arena_p->free_head = K_DBM_ARENA_INVALID_OFFSET;
+	arena_p->used	   = 0;
+	if (arena_p->size > sizeof(k_dbm_arena_block_t))
+	{
+		k_dbm_arena_block_t *block_p = k_dbm_arena_block(arena_p, 0);
+		block_p->size				 = arena_p->size;
+		block_p->next				 = K_DBM_ARENA_INVALID_OFFSET;
+		arena_p->free_head			 = 0;
+	}
+}
+
+uint32_t k_dbm_arena_alloc(k_dbm_arena_t *arena_p, size_t size)
+{
+	uint32_t	   offset	  = K_DBM_ARENA_INVALID_OFFSET;
+	const uint32_t block_size = (uint32_t)K_DBM_ARENA_ALIGN(size + sizeof(k_dbm_arena_block_t));
+	uint32_t	   prev		  = K_DBM_ARENA_INVALID_OFFSET;
+	uint32_t	   current	  = arena_p->free_head;
+
+	/* First fit over the address ordered free list */
+	while (K_DBM_ARENA_INVALID_OFFSET != current && k_dbm_arena_block(arena_p, current)->size < block_size)
+	{
+		prev	= current;
+		current = k_dbm_arena_block(arena_p, current)->next;
+	}
+	if (K_DBM_ARENA_INVALID_OFFSET != current)
+	{
+		k_dbm_arena_block_t *block_p = k_dbm_arena_block(arena_p, current);
+		uint32_t			 next	 = block_p->next;
+		if (block_p->size - block_size > sizeof(k_dbm_arena_block_t))
+		{
+			/* Split, the tail of the block stays in the free list */
+			k_dbm_arena_block_t *tail_p = k_dbm_arena_block(arena_p, current + block_size);
+			tail_p->size				= block_p->size - block_size;
+			tail_p->next				= next;
+			next						= current + block_size;
+			block_p->size				= block_size;
+		}
+		if (K_DBM_ARENA_INVALID_OFFSET == prev)
+		{
+			arena_p->free_head = next;
+		}
+		else
+		{
+			k_dbm_arena_block(arena_p, prev)->next = next;
+		}
+		arena_p->used += block_p->size;
+		offset = current + (uint32_t)sizeof(k_dbm_arena_block_t);
+	}
+	return offset;
+}
+
+void k_dbm_arena_free(k_dbm_arena_t *arena_p, uint32_t offset)
+{
+	if (K_DBM_ARENA_INVALID_OFFSET != offset)
+	{
+		const uint32_t		 block	 = offset - (uint32_t)sizeof(k_dbm_arena_block_t);
+		k_dbm_arena_block_t *block_p = k_dbm_arena_block(arena_p, block);
+		uint32_t			 prev	 = K_DBM_ARENA_INVALID_OFFSET;
+		uint32_t			 next	 = arena_p->free_head;
+		arena_p->used -= block_p->size;
+
+		while (K_DBM_ARENA_INVALID_OFFSET != next && next < block)
+		{
+			prev = next;
+			next = k_dbm_arena_block(arena_p, next)->next;
+		}
+
+		/* Merge with the following free block */
+		block_p->next = next;
+		if (K_DBM_ARENA_INVALID_OFFSET != next && block + block_p->size == next)
+		{
+			block_p->size += k_dbm_arena_block(arena_p, next)->size;
+			block_p->next = k_dbm_arena_block(arena_p, next)->next;
+		}
+
+		/* Merge with the preceding free block */
+		if (K_DBM_ARENA_INVALID_OFFSET == prev)
+		{
+			arena_p->free_head = block;
+		}
+		else
+		{
+			k_dbm_arena_block_t *prev_p = k_dbm_arena_block(arena_p, prev);
+			if (prev + prev_p->size == block)
+			{
+				prev_p->size += block_p->size;
+				prev_p->next = block_p->next;
+			}
+			else
+			{
+				prev_p->next = block;
+			}
+		}
+	}
+}
+
+void k_dbm_arena_shrink(k_dbm_arena_t *arena_p, uint32_t offset, size_t size)
+{
+	const uint32_t		 block		= offset - (uint32_t)sizeof(k_dbm_arena_block_t);
+	k_dbm_arena_block_t *block_p	= k_dbm_arena_block(arena_p, block);
+	const uint32_t		 block_size = (uint32_t)K_DBM_ARENA_ALIGN(size + sizeof(k_dbm_arena_block_t));
+	if (block_p->size - block_size > sizeof(k_dbm_arena_block_t))
+	{
+		/* Turn the tail into an allocated block and free it, so it is merged with its free neighbours */
+		k_dbm_arena_block_t *tail_p = k_dbm_arena_block(arena_p, block + block_size);
+		tail_p->size				= block_p->size - block_size;
+		block_p->size				= block_size;
+		k_dbm_arena_free(arena_p, block + block_size + (uint32_t)sizeof(k_dbm_arena_block_t));
+	}
+}
+
+size_t k_dbm_arena_capacity(const k_dbm_arena_t *arena_p, uint32_t offset)
+{
+	return k_dbm_arena_block(arena_p, offset - (uint32_t)sizeof(k_dbm_arena_block_t))->size - sizeof(k_dbm_arena_block_t);
+}
+
+void *k_dbm_arena_ptr(const k_dbm_arena_t *arena_p, uint32_t offset) { return arena_p->buffer_p + offset; }
+
+static k_dbm_arena_block_t *k_dbm_arena_block(const k_dbm_arena_t *arena_p, uint32_t offset)
+{
+	return (k_dbm_arena_block_t *)(void *)(arena_p->buffer_p + offset);
+}
@@ -0,0 +1,85 @@
+/**
+ * @file k_dbm_eviction.c
+ * @ingroup k_dbm
+ * @{
+ */
+
+/* Include -------------------------------------------------------------------*/
+#include "k_dbm_priv.h"
+
+/* Macro ---------------------------------------------------------------------*/
+/* Typedef -------------------------------------------------------------------*/
+/* Function Declaration ------------------------------------------------------*/
+#if K_DBM_NVM_CACHE_EVICTION
+static int k_dbm_eviction_find_victim(void);
+static int k_dbm_eviction_is_candidate(int db_index);
+#endif
+
+/* Constant ------------------------------------------------------------------*/
+/* Variable ------------------------------------------------------------------*/
+/* Function Definition -------------------------------------------------------*/
+void k_dbm_eviction_touch(int db_index)
+{
+#if K_DBM_NVM_CACHE_EVICTION
+	k_dbm_context.db.entries_a[db_index].is_referenced = 1;
+#else
+	(void)db_index;
+#endif
+}
+
+int k_dbm_eviction_evict(uint32_t hash, int is_hint)
+{
+	int ret_code = -1;
+#if K_DBM_NVM_CACHE_EVICTION
+	const int victim = k_dbm_eviction_find_victim();
+	if (-1 != victim)
+	{
+		if (is_hint || k_dbm_admission_admit(hash, k_dbm_context.db.entries_a[victim].key_hash))
+		{
+			k_dbm_free_entry(victim);
+			k_dbm_context.db.stats.evictions++;
+			ret_code = 0;
+		}
+		else
+		{
+			k_dbm_context.db.stats.admissions_rejected++;
+		}
+	}
+#else
+	(void)hash;
+	(void)is_hint;
+#endif
+	return ret_code;
+}
+
+#if K_DBM_NVM_CACHE_EVICTION
+static int k_dbm_eviction_find_victim(void)
+{
+	int victim = -1;
+	/* CLOCK: the hand clears the reference bits it passes, two turns always reach an unreferenced candidate if any */
+	for (size_t step = 0; step < 2 * K_DBM_DYNAMIC_DB_SIZE && -1 == victim; step++)
+	{
+		const int db_index			 = (int)k_dbm_context.db.clock_hand;
+		k_dbm_context.db.clock_hand = (k_dbm_context.db.clock_hand + 1) % K_DBM_DYNAMIC_DB_SIZE;
+		if (k_dbm_eviction_is_candidate(db_index))
+		{
+			if (k_dbm_context.db.entries_a[db_index].is_referenced)
+			{
+				k_dbm_context.db.entries_a[db_index].is_referenced = 0;	 // Second chance
+			}
+			else
+			{
+				victim = db_index;
+			}
+		}
+	}
+	return victim;
+}
+
+static int k_dbm_eviction_is_candidate(int db_index)
+{
+	/* Only clean NVM entries can be dropped, NVM holds their value. RAM entries are the only copy of their value */
+	const k_dbm_entry_t *entry_p = &k_dbm_context.db.entries_a[db_index];
+	return K_DBM_STORAGE_NVM == entry_p->storage && !entry_p->is_dirty;
+}
+#endif
@@ -0,0 +1,307 @@
+/**
+ * @file k_dbm_index.c
+ * @ingroup k_dbm
+ * @{
+ */
+
+/* Include -------------------------------------------------------------------*/
+#include <string.h>
+
+#include "k_dbm_priv.h"
+
+/* Macro ---------------------------------------------------------------------*/
+#define K_DBM_FNV_OFFSET_BASIS (2166136261u)
+#define K_DBM_FNV_PRIME		   (16777619u)
+
+#if K_DBM_INDEX_STRATEGY == K_DBM_INDEX_FINGERPRINT
+#if defined(K_DBM_FINGERPRINT_PORTABLE)
+#elif defined(__AVX2__)
+#define K_DBM_FINGERPRINT_AVX2
+#elif defined(__SSE2__)
+#define K_DBM_FINGERPRINT_SSE2
+#elif defined(__ARM_NEON)
+#define K_DBM_FINGERPRINT_NEON
+#endif
+
+#if defined(K_DBM_FINGERPRINT_AVX2) || defined(K_DBM_FINGERPRINT_SSE2)
+#include <immintrin.h>
+#elif defined(K_DBM_FINGERPRINT_NEON)
+#include <arm_neon.h>
+#endif
+
+#if defined(K_DBM_FINGERPRINT_AVX2)
+#define K_DBM_FINGERPRINT_BLOCK_SIZE (32)
+#elif defined(K_DBM_FINGERPRINT_SSE2) || defined(K_DBM_FINGERPRINT_NEON)
+#define K_DBM_FINGERPRINT_BLOCK_SIZE (16)
+#else
+#define K_DBM_FINGERPRINT_BLOCK_SIZE (32)
+#endif
+
+#if defined(K_DBM_FINGERPRINT_NEON)
+#define K_DBM_FINGERPRINT_MASK_FIRST(mask) (__builtin_ctzll(mask) / 4)
+#elif defined(K_DBM_FINGERPRINT_AVX2) || defined(K_DBM_FINGERPRINT_SSE2)
+#define K_DBM_FINGERPRINT_MASK_FIRST(mask) __builtin_ctz(mask)
+#else
+#define K_DBM_FINGERPRINT_MASK_FIRST(mask) k_dbm_fingerprint_mask_first(mask)
+#endif
+#endif
+
+/* Typedef -------------------------------------------------------------------*/
+#if K_DBM_INDEX_STRATEGY == K_DBM_INDEX_FINGERPRINT
+#if defined(K_DBM_FINGERPRINT_NEON)
+typedef uint64_t k_dbm_fingerprint_mask_t;	//!< 4 bits per entry
+#else
+typedef uint32_t k_dbm_fingerprint_mask_t;	//!< 1 bit per entry
+#endif
+#endif
+
+/* Function Declaration ------------------------------------------------------*/
+#if K_DBM_INDEX_STRATEGY == K_DBM_INDEX_FINGERPRINT
+/**
+ * @brief Compare the fingerprints of one block of entries against a fingerprint
+ *
+ * @param block_p First fingerprint of the block, K_DBM_FINGERPRINT_BLOCK_SIZE fingerprints are read
+ * @param fingerprint Fingerprint to search for
+ *
+ * @return Match mask, K_DBM_FINGERPRINT_MASK_FIRST gives the block offset of the first match
+ */
+static k_dbm_fingerprint_mask_t k_dbm_fingerprint_match(const uint8_t *block_p, uint8_t fingerprint);
+
+#if !defined(K_DBM_FINGERPRINT_AVX2) && !defined(K_DBM_FINGERPRINT_SSE2) && !defined(K_DBM_FINGERPRINT_NEON)
+/**
+ * @brief Portable count of trailing zeros of a non zero mask
+ */
+static int k_dbm_fingerprint_mask_first(k_dbm_fingerprint_mask_t mask);
+#endif
+#endif
+
+/**
+ * @brief Compare two keys in lexicographic byte order
+ *
+ * @return <0, 0 or >0 if the first key is lower, equal or greater than the second one
+ */
+static int k_dbm_key_compare(const char *key_a_p, size_t key_a_len, const char *key_b_p, size_t key_b_len);
+
+/* Constant ------------------------------------------------------------------*/
+/* Variable ------------------------------------------------------------------*/
+/* Function Definition -------------------------------------------------------*/
+uint32_t k_dbm_hash_key(const char *key_p, size_t *key_len_p)
+{
+	uint32_t	hash = K_DBM_FNV_OFFSET_BASIS;
+	const char *c_p	 = key_p;
+	while (*c_p)
+	{
+		hash ^= (uint8_t)*c_p++;
+		hash *= K_DBM_FNV_PRIME;
+	}
+	*key_len_p = (size_t)(c_p - key_p);
+	return hash;
+}
+
+uint32_t k_dbm_hash_mix(uint32_t hash)
+{
+	/* Murmur3 finalizer */
+	hash ^= hash >> 16;
+	hash *= 0x85EBCA6Bu;
+	hash ^= hash >> 13;
+	hash *= 0xC2B2AE35u;
+	hash ^= hash >> 16;
+	return hash;
+}
+
+int k_dbm_find_entry(const char *key_p)
+{
+	size_t		   bucket	= 0;
+	size_t		   key_len	= 0;
+	const uint32_t hash		= k_dbm_hash_key(key_p, &key_len);
+	int			   db_index = k_dbm_index_lookup(key_p, key_len, hash, &bucket);
+	if (-1 != db_index && K_DBM_STORAGE_NONE == k_dbm_context.db.entries_a[db_index].storage)
+	{
+		db_index = -1;	// Static key without value
+	}
+	return db_index;
+}
+
+#if K_DBM_INDEX_STRATEGY == K_DBM_INDEX_HASH
+int k_dbm_index_lookup(const char *key_p, size_t key_len, uint32_t hash, size_t *bucket_p)
+{
+	int	   index  = -1;
+	size_t bucket = hash & K_DBM_HASH_INDEX_MASK;
+	while (0 != k_dbm_context.db.hash_index_a[bucket])
+	{
+		const int			 db_index = (int)k_dbm_context.db.hash_index_a[bucket] - 1;
+		const k_dbm_entry_t *entry_p  = &k_dbm_context.db.entries_a[db_index];
+		/* Hash and length reject mismatches without dereferencing the stored key */
+		if (entry_p->key_hash == hash && entry_p->key_len == key_len && 0 == memcmp(entry_p->key, key_p, key_len))
+		{
+			index = db_index;
+			break;
+		}
+		bucket = (bucket + 1) & K_DBM_HASH_INDEX_MASK;
+	}
+	*bucket_p = bucket;
+	return index;
+}
+
+void k_dbm_index_insert(int db_index, size_t bucket) { k_dbm_context.db.hash_index_a[bucket] = (k_dbm_slot_t)(db_index + 1); }
+
+void k_dbm_index_remove(int db_index)
+{
+	size_t bucket = k_dbm_context.db.entries_a[db_index].key_hash & K_DBM_HASH_INDEX_MASK;
+	while (0 != k_dbm_context.db.hash_index_a[bucket] && k_dbm_context.db.hash_index_a[bucket] != (k_dbm_slot_t)(db_index + 1))
+	{
+		bucket = (bucket + 1) & K_DBM_HASH_INDEX_MASK;
+	}
+	if (0 != k_dbm_context.db.hash_index_a[bucket])
+	{
+		/* Backward shift deletion: pull following entries of the cluster into the hole, so no tombstone is needed */
+		size_t hole = bucket;
+		size_t next = (hole + 1) & K_DBM_HASH_INDEX_MASK;
+		while (0 != k_dbm_context.db.hash_index_a[next])
+		{
+			const int	 moved_index = (int)k_dbm_context.db.hash_index_a[next] - 1;
+			const size_t home		 = k_dbm_context.db.entries_a[moved_index].key_hash & K_DBM_HASH_INDEX_MASK;
+			/* The entry can fill the hole only if its home bucket is not cyclically in (hole, next] */
+			if (((next - home) & K_DBM_HASH_INDEX_MASK) >= ((next - hole) & K_DBM_HASH_INDEX_MASK))
+			{
+				k_dbm_context.db.hash_index_a[hole] = k_dbm_context.db.hash_index_a[next];
+				hole								= next;
+			}
+			next = (next + 1) & K_DBM_HASH_INDEX_MASK;
+		}
+		k_dbm_context.db.hash_index_a[hole] = 0;
+	}
+}
+#else
+int k_dbm_index_lookup(const char *key_p, size_t key_len, uint32_t hash, size_t *bucket_p)
+{
+	int			  index		  = -1;
+	const uint8_t fingerprint = K_DBM_FINGERPRINT(hash);
+	for (size_t base = 0; base < K_DBM_FINGERPRINT_ARRAY_SIZE && -1 == index; base += K_DBM_FINGERPRINT_BLOCK_SIZE)
+	{
+		/* Bit i of the mask is set when the fingerprint of entry base + i matches */
+		k_dbm_fingerprint_mask_t mask = k_dbm_fingerprint_match(&k_dbm_context.db.fingerprints_a[base], fingerprint);
+		while (0 != mask && -1 == index)
+		{
+			const int			 db_index = (int)(base + (size_t)K_DBM_FINGERPRINT_MASK_FIRST(mask));
+			const k_dbm_entry_t *entry_p  = &k_dbm_context.db.entries_a[db_index];
+			if (entry_p->key_hash == hash && entry_p->key_len == key_len && 0 == memcmp(entry_p->key, key_p, key_len))
+			{
+				index = db_index;
+			}
+			mask &= mask - 1;
+		}
+	}
+	*bucket_p = 0;	// No bucket, the fingerprint lives at the entry position
+	return index;
+}
+
+void k_dbm_index_insert(int db_index, size_t bucket)
+{
+	(void)bucket;
+	k_dbm_context.db.fingerprints_a[db_index] = K_DBM_FINGERPRINT(k_dbm_context.db.entries_a[db_index].key_hash);
+}
+
+void k_dbm_index_remove(int db_index) { k_dbm_context.db.fingerprints_a[db_index] = 0; }
+
+static k_dbm_fingerprint_mask_t k_dbm_fingerprint_match(const uint8_t *block_p, uint8_t fingerprint)
+{
+#if defined(K_DBM_FINGERPRINT_AVX2)
+	const __m256i block = _mm256_loadu_si256((const __m256i *)(const void *)block_p);
+	return (k_dbm_fingerprint_mask_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(block, _mm256_set1_epi8((char)fingerprint)));
+#elif defined(K_DBM_FINGERPRINT_SSE2)
+	const __m128i block = _mm_loadu_si128((const __m128i *)(const void *)block_p);
+	return (k_dbm_fingerprint_mask_t)_mm_movemask_epi8(_mm_cmpeq_epi8(block, _mm_set1_epi8((char)fingerprint)));
+#elif defined(K_DBM_FINGERPRINT_NEON)
+	/* Narrow the byte compare result to 4 bits per entry */
+	const uint8x16_t matches = vceqq_u8(vld1q_u8(block_p), vdupq_n_u8(fingerprint));
+	const uint8x8_t	 nibbles = vshrn_n_u16(vreinterpretq_u16_u8(matches), 4);
+	return vget_lane_u64(vreinterpret_u64_u8(nibbles), 0) & 0x1111111111111111ull;
+#else
+	/* SWAR: flag the blocks holding a zero byte once XORed with the fingerprint, then confirm byte by byte */
+	k_dbm_fingerprint_mask_t mask = 0;
+	for (size_t word = 0; word < K_DBM_FINGERPRINT_BLOCK_SIZE; word += sizeof(uint64_t))
+	{
+		uint64_t value = 0;
+		memcpy(&value, &block_p[word], sizeof(value));
+		value ^= 0x0101010101010101ull * fingerprint;
+		if ((value - 0x0101010101010101ull) & ~value & 0x8080808080808080ull)
+		{
+			for (size_t byte = 0; byte < sizeof(uint64_t); byte++)
+			{
+				if (block_p[word + byte] == fingerprint)
+				{
+					mask |= (k_dbm_fingerprint_mask_t)1 << (word + byte);
+				}
+			}
+		}
+	}
+	return mask;
+#endif
+}
+
+#if !defined(K_DBM_FINGERPRINT_AVX2) && !defined(K_DBM_FINGERPRINT_SSE2) && !defined(K_DBM_FINGERPRINT_NEON)
+static int k_dbm_fingerprint_mask_first(k_dbm_fingerprint_mask_t mask)
+{
+	int first = 0;
+	while (0 == (mask & 1u))
+	{
+		mask >>= 1;
+		first++;
+	}
+	return first;
+}
+#endif
+#endif
+
+size_t k_dbm_ordered_lower_bound(const char *key_p, size_t key_len)
+{
+	size_t low	= 0;
+	size_t high = k_dbm_context.db.ordered_count;
+	while (low < high)
+	{
+		const size_t		 middle	 = low + (high - low) / 2;
+		const k_dbm_entry_t *entry_p = &k_dbm_context.db.entries_a[k_dbm_context.db.ordered_index_a[middle]];
+		if (k_dbm_key_compare(entry_p->key, entry_p->key_len, key_p, key_len) < 0)
+		{
+			low = middle + 1;
+		}
+		else
+		{
+			high = middle;
+		}
+	}
+	return low;
+}
+
+void k_dbm_ordered_insert(int db_index)
+{
+	const k_dbm_entry_t *entry_p  = &k_dbm_context.db.entries_a[db_index];
+	const size_t		 position = k_dbm_ordered_lower_bound(entry_p->key, entry_p->key_len);
+	memmove(&k_dbm_context.db.ordered_index_a[position + 1], &k_dbm_context.db.ordered_index_a[position],
+			(k_dbm_context.db.ordered_count - position) * sizeof(k_dbm_context.db.ordered_index_a[0]));
+	k_dbm_context.db.ordered_index_a[position] = (k_dbm_slot_t)db_index;
+	k_dbm_context.db.ordered_count++;
+}
+
+void k_dbm_ordered_remove(int db_index)
+{
+	const k_dbm_entry_t *entry_p  = &k_dbm_context.db.entries_a[db_index];
+	const size_t		 position = k_dbm_ordered_lower_bound(entry_p->key, entry_p->key_len);
+	if (position < k_dbm_context.db.ordered_count && k_dbm_context.db.ordered_index_a[position] == (k_dbm_slot_t)db_index)
+	{
+		k_dbm_context.db.ordered_count--;
+		memmove(&k_dbm_context.db.ordered_index_a[position], &k_dbm_context.db.ordered_index_a[position + 1],
+				(k_dbm_context.db.ordered_count - position) * sizeof(k_dbm_context.db.ordered_index_a[0]));
+	}
+}
+
+static int k_dbm_key_compare(const char *key_a_p, size_t key_a_len, const char *key_b_p, size_t key_b_len)
+{
+	int result = memcmp(key_a_p, key_b_p, key_a_len < key_b_len ? key_a_len : key_b_len);
+	if (0 == result)
+	{
+		result = (key_a_len > key_b_len) - (key_a_len < key_b_len);
+	}
+	return result;
+}
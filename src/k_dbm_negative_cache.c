@@ -0,0 +1,84 @@
+/**
+ * @file k_dbm_negative_cache.c
+ * @ingroup k_dbm
+ * @{
+ */
+
+/* Include -------------------------------------------------------------------*/
+#include <string.h>
+
+#include "k_dbm_priv.h"
+
+/* Macro ---------------------------------------------------------------------*/
+/* Typedef -------------------------------------------------------------------*/
+/* Function Declaration ------------------------------------------------------*/
+#if K_DBM_NEGATIVE_CACHE_SIZE > 0
+static k_dbm_negative_entry_t *k_dbm_negative_cache_find(const char *key_p, size_t key_len, uint32_t hash);
+#endif
+
+/* Constant ------------------------------------------------------------------*/
+/* Variable ------------------------------------------------------------------*/
+/* Function Definition -------------------------------------------------------*/
+int k_dbm_negative_cache_contains(const char *key_p, size_t key_len, uint32_t hash)
+{
+	int ret_code = 0;
+#if K_DBM_NEGATIVE_CACHE_SIZE > 0
+	ret_code = NULL != k_dbm_negative_cache_find(key_p, key_len, hash);
+#else
+	(void)key_p;
+	(void)key_len;
+	(void)hash;
+#endif
+	return ret_code;
+}
+
+void k_dbm_negative_cache_add(const char *key_p, size_t key_len, uint32_t hash)
+{
+#if K_DBM_NEGATIVE_CACHE_SIZE > 0
+	if (key_len <= K_DBM_NEGATIVE_CACHE_KEY_MAX_LENGTH && !k_dbm_negative_cache_find(key_p, key_len, hash))
+	{
+		/* FIFO replacement, the slot after the newest key holds the oldest one */
+		k_dbm_negative_entry_t *slot_p = &k_dbm_context.db.negative_cache_a[k_dbm_context.db.negative_cache_next];
+		slot_p->key_hash			   = hash;
+		slot_p->key_len				   = (uint16_t)key_len;
+		slot_p->is_used				   = 1;
+		memcpy(slot_p->key, key_p, key_len);
+		k_dbm_context.db.negative_cache_next = (k_dbm_context.db.negative_cache_next + 1) % K_DBM_NEGATIVE_CACHE_SIZE;
+	}
+#else
+	(void)key_p;
+	(void)key_len;
+	(void)hash;
+#endif
+}
+
+void k_dbm_negative_cache_remove(const char *key_p, size_t key_len, uint32_t hash)
+{
+#if K_DBM_NEGATIVE_CACHE_SIZE > 0
+	k_dbm_negative_entry_t *slot_p = k_dbm_negative_cache_find(key_p, key_len, hash);
+	if (slot_p)
+	{
+		slot_p->is_used = 0;
+	}
+#else
+	(void)key_p;
+	(void)key_len;
+	(void)hash;
+#endif
+}
+
+#if K_DBM_NEGATIVE_CACHE_SIZE > 0
+static k_dbm_negative_entry_t *k_dbm_negative_cache_find(const char *key_p, size_t key_len, uint32_t hash)
+{
+	k_dbm_negative_entry_t *slot_p = NULL;
+	for (size_t i = 0; i < K_DBM_NEGATIVE_CACHE_SIZE && !slot_p; i++)
+	{
+		k_dbm_negative_entry_t *candidate_p = &k_dbm_context.db.negative_cache_a[i];
+		if (candidate_p->is_used && candidate_p->key_hash == hash && candidate_p->key_len == key_len && 0 == memcmp(candidate_p->key, key_p, key_len))
+		{
+			slot_p = candidate_p;
+		}
+	}
+	return slot_p;
+}
+#endif
@@ -0,0 +1,127 @@
+/**
+ * @file k_dbm_nvm_filter.c
+ * @ingroup k_dbm
+ * @{
+ */
+
+/* Include -------------------------------------------------------------------*/
+#include <string.h>
+
+#include "k_dbm_priv.h"
+
+/* Macro ---------------------------------------------------------------------*/
+#define K_DBM_NVM_FILTER_COUNTER_MAX (0x0Fu)
+
+/* Typedef -------------------------------------------------------------------*/
+/* Function Declaration ------------------------------------------------------*/
+#if K_DBM_NVM_FILTER_SIZE > 0
+static int		k_dbm_nvm_filter_enumerate_cb(const char *key_p, void *ctx_p);
+static size_t	k_dbm_nvm_filter_counter_index(uint32_t hash, uint32_t step, size_t i);
+static uint32_t k_dbm_nvm_filter_step(uint32_t hash);
+static uint8_t	k_dbm_nvm_filter_counter_get(size_t counter);
+static void		k_dbm_nvm_filter_counter_set(size_t counter, uint8_t value);
+#endif
+
+/* Constant ------------------------------------------------------------------*/
+/* Variable ------------------------------------------------------------------*/
+/* Function Definition -------------------------------------------------------*/
+void k_dbm_nvm_filter_init(void)
+{
+#if K_DBM_NVM_FILTER_SIZE > 0
+	memset(k_dbm_context.db.nvm_filter_a, 0, sizeof(k_dbm_context.db.nvm_filter_a));
+	k_dbm_context.db.nvm_filter_is_ready = 0;
+	if (k_dbm_context.config.k_dbm_enumerate_f && 0 == k_dbm_context.config.k_dbm_enumerate_f(k_dbm_nvm_filter_enumerate_cb, NULL))
+	{
+		/* A partial enumeration would reject keys that are in NVM, the filter is only used if it is complete */
+		k_dbm_context.db.nvm_filter_is_ready = 1;
+	}
+#endif
+}
+
+void k_dbm_nvm_filter_add(uint32_t hash)
+{
+#if K_DBM_NVM_FILTER_SIZE > 0
+	const uint32_t step = k_dbm_nvm_filter_step(hash);
+	for (size_t i = 0; i < K_DBM_NVM_FILTER_HASH_COUNT; i++)
+	{
+		const size_t  counter = k_dbm_nvm_filter_counter_index(hash, step, i);
+		const uint8_t value	  = k_dbm_nvm_filter_counter_get(counter);
+		if (value < K_DBM_NVM_FILTER_COUNTER_MAX)
+		{
+			k_dbm_nvm_filter_counter_set(counter, value + 1);
+		}
+	}
+#else
+	(void)hash;
+#endif
+}
+
+void k_dbm_nvm_filter_remove(uint32_t hash)
+{
+#if K_DBM_NVM_FILTER_SIZE > 0
+	const uint32_t step = k_dbm_nvm_filter_step(hash);
+	for (size_t i = 0; i < K_DBM_NVM_FILTER_HASH_COUNT; i++)
+	{
+		const size_t  counter = k_dbm_nvm_filter_counter_index(hash, step, i);
+		const uint8_t value	  = k_dbm_nvm_filter_counter_get(counter);
+		/* A saturated counter has lost track of its keys and stays set */
+		if (value > 0 && value < K_DBM_NVM_FILTER_COUNTER_MAX)
+		{
+			k_dbm_nvm_filter_counter_set(counter, value - 1);
+		}
+	}
+#else
+	(void)hash;
+#endif
+}
+
+int k_dbm_nvm_filter_may_contain(uint32_t hash)
+{
+	int ret_code = 1;
+#if K_DBM_NVM_FILTER_SIZE > 0
+	if (k_dbm_context.db.nvm_filter_is_ready)
+	{
+		const uint32_t step = k_dbm_nvm_filter_step(hash);
+		for (size_t i = 0; i < K_DBM_NVM_FILTER_HASH_COUNT && ret_code; i++)
+		{
+			ret_code = 0 != k_dbm_nvm_filter_counter_get(k_dbm_nvm_filter_counter_index(hash, step, i));
+		}
+	}
+#else
+	(void)hash;
+#endif
+	return ret_code;
+}
+
+#if K_DBM_NVM_FILTER_SIZE > 0
+static int k_dbm_nvm_filter_enumerate_cb(const char *key_p, void *ctx_p)
+{
+	size_t key_len = 0;
+	(void)ctx_p;
+	k_dbm_nvm_filter_add(k_dbm_hash_key(key_p, &key_len));
+	return 0;
+}
+
+static size_t k_dbm_nvm_filter_counter_index(uint32_t hash, uint32_t step, size_t i)
+{
+	/* Double hashing, the counters of a key are derived from the key hash only */
+	return (size_t)((hash + (uint32_t)i * step) % K_DBM_NVM_FILTER_SIZE);
+}
+
+static uint32_t k_dbm_nvm_filter_step(uint32_t hash)
+{
+	/* Decorrelate the step from the start counter */
+	return k_dbm_hash_mix(hash) | 1u;
+}
+
+static uint8_t k_dbm_nvm_filter_counter_get(size_t counter)
+{
+	return (uint8_t)((k_dbm_context.db.nvm_filter_a[counter / 2] >> ((counter % 2) * 4)) & K_DBM_NVM_FILTER_COUNTER_MAX);
+}
+
+static void k_dbm_nvm_filter_counter_set(size_t counter, uint8_t value)
+{
+	const unsigned shift					 = (unsigned)(counter % 2) * 4;
+	k_dbm_context.db.nvm_filter_a[counter / 2] = (uint8_t)((k_dbm_context.db.nvm_filter_a[counter / 2] & ~(K_DBM_NVM_FILTER_COUNTER_MAX << shift)) | (value << shift));
+}
+#endif
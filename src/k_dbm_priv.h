@@ -12,8 +12,12 @@ extern "C"
 
 /* Include -------------------------------------------------------------------*/
 #include <stddef.h>
+#include <stdint.h>
 
 #include "k_dbm.h"
+#ifdef K_DBM_KEY_REGISTRY
+#include "k_dbm_keys.h"
+#endif
 
 /* Macro ---------------------------------------------------------------------*/
 #ifndef K_DBM_DB_SIZE
@@ -22,27 +26,402 @@ extern "C"
 #ifndef K_DBM_VALUE_MAX_LENGTH
 #error "Max value length must be defined at compile time"
 #endif
+#ifndef K_DBM_STATIC_KEY_COUNT
+/**
+ * @brief Number of keys of the compile-time key registry (see k_dbm_generate_key_registry)
+ */
+#define K_DBM_STATIC_KEY_COUNT 0
+#endif
+#if K_DBM_STATIC_KEY_COUNT >= K_DBM_DB_SIZE
+#error "DB size must leave room for runtime keys after the static keys"
+#endif
+
+/**
+ * @brief Number of entries available to runtime keys, static keys own the last entries of the DB
+ */
+#define K_DBM_DYNAMIC_DB_SIZE		(K_DBM_DB_SIZE - K_DBM_STATIC_KEY_COUNT)
+#define K_DBM_STATIC_KEY_INDEX(id)	((int)(K_DBM_DYNAMIC_DB_SIZE + (id)))
+#define K_DBM_IS_STATIC_ENTRY(index) ((index) >= (int)K_DBM_DYNAMIC_DB_SIZE)
+
+#ifndef K_DBM_KEY_ARENA_SIZE
+/**
+ * @brief Size in bytes of the key arena, 0 disables it
+ *
+ * When enabled, keys are copied into the arena on insert and on NVM cache fill,
+ * so callers can pass temporary buffers as keys. Each resident key is stored once.
+ */
+#define K_DBM_KEY_ARENA_SIZE 0
+#endif
+
+#ifndef K_DBM_NEGATIVE_CACHE_SIZE
+/**
+ * @brief Number of keys known to be absent from NVM that are remembered, 0 disables the negative cache
+ *
+ * A k_dbm_get miss on a remembered key returns without calling k_dbm_get_f. The oldest key is
+ * evicted when the cache is full, and a key is forgotten as soon as it is inserted.
+ */
+#define K_DBM_NEGATIVE_CACHE_SIZE 0
+#endif
+#ifndef K_DBM_NEGATIVE_CACHE_KEY_MAX_LENGTH
+/**
+ * @brief Longest key the negative cache can remember, longer keys always reach NVM
+ */
+#define K_DBM_NEGATIVE_CACHE_KEY_MAX_LENGTH 32
+#endif
+
+#ifndef K_DBM_NVM_CACHE_EVICTION
+/**
+ * @brief 1 to let NVM cache fills evict clean NVM entries when the DB is full, 0 to skip caching instead
+ *
+ * Victims are chosen with the CLOCK algorithm, an entry read since the hand last passed gets a second chance.
+ * Inserts of new keys also evict a clean NVM entry rather than fail, whatever the admission policy.
+ * RAM entries and NVM entries whose value has not been saved yet are never evicted.
+ */
+#define K_DBM_NVM_CACHE_EVICTION 1
+#endif
+
+#ifndef K_DBM_ADMISSION_SKETCH_SIZE
+/**
+ * @brief Number of 4 bit counters of the TinyLFU frequency sketch, 0 disables the admission policy
+ *
+ * Every client read is counted in a count-min sketch, warm-up and prefetch loads are not. When a NVM read would evict an entry, the new key is only cached
+ * if it has been read more often than the victim, so one-off sweeps do not push out frequently read keys.
+ * Counters are halved every 10 * K_DBM_ADMISSION_SKETCH_SIZE reads, so old activity fades out.
+ */
+#define K_DBM_ADMISSION_SKETCH_SIZE 0
+#endif
+
+#ifndef K_DBM_LOAD_BATCH_SIZE
+/**
+ * @brief Number of keys read by each k_dbm_get_batch_f call of k_dbm_warmup and k_dbm_prefetch
+ *
+ * The values of a batch are buffered on the stack of the thread running the load, which takes
+ * K_DBM_LOAD_BATCH_SIZE * K_DBM_VALUE_MAX_LENGTH bytes.
+ */
+#define K_DBM_LOAD_BATCH_SIZE 4
+#endif
+#if K_DBM_LOAD_BATCH_SIZE < 1
+#error "Load batch size must be at least 1"
+#endif
+
+#ifndef K_DBM_FLUSH_KEY_MAX_LENGTH
+/**
+ * @brief Longest key, terminator included, whose deferred value a flush saves without holding the mutex
+ *
+ * The key and the value are copied into the DB context before the NVM write, values of longer keys are
+ * saved with the mutex held.
+ */
+#define K_DBM_FLUSH_KEY_MAX_LENGTH 32
+#endif
+
+#ifndef K_DBM_NVM_FILTER_SIZE
+/**
+ * @brief Number of 4 bit counters of the counting Bloom filter over the NVM key set, 0 disables the filter
+ *
+ * The filter is built by k_dbm_init from k_dbm_enumerate_f and kept up to date by insert and delete.
+ * A k_dbm_get miss on a key the filter rejects returns without calling k_dbm_get_f.
+ * Without k_dbm_enumerate_f, or if the enumeration fails, every miss still reaches NVM.
+ */
+#define K_DBM_NVM_FILTER_SIZE 0
+#endif
+#ifndef K_DBM_NVM_FILTER_HASH_COUNT
+/**
+ * @brief Number of counters touched by each key
+ */
+#define K_DBM_NVM_FILTER_HASH_COUNT 3
+#endif
+
+/**
+ * @brief Value storage modes, selected at compile time with K_DBM_VALUE_STORAGE
+ *
+ * - K_DBM_VALUE_STORAGE_INLINE: every entry embeds a buffer of K_DBM_VALUE_MAX_LENGTH bytes
+ * - K_DBM_VALUE_STORAGE_ARENA: values are allocated from an arena of K_DBM_VALUE_ARENA_SIZE bytes shared by all
+ *   the entries, which only keep the offset and the length of their value. K_DBM_VALUE_MAX_LENGTH still bounds
+ *   a single value
+ * - K_DBM_VALUE_STORAGE_SLAB: values are allocated from up to K_DBM_SLAB_CLASS_MAX pools of fixed size blocks,
+ *   class i holds K_DBM_SLAB_CLASS_<i>_COUNT blocks of K_DBM_SLAB_CLASS_<i>_SIZE bytes. Allocations run in
+ *   constant time and never fail because of fragmentation
+ */
+#define K_DBM_VALUE_STORAGE_INLINE (1)
+#define K_DBM_VALUE_STORAGE_ARENA  (2)
+#define K_DBM_VALUE_STORAGE_SLAB   (3)
+#ifndef K_DBM_VALUE_STORAGE
+#define K_DBM_VALUE_STORAGE K_DBM_VALUE_STORAGE_INLINE
+#endif
+#if K_DBM_VALUE_STORAGE != K_DBM_VALUE_STORAGE_INLINE && K_DBM_VALUE_STORAGE != K_DBM_VALUE_STORAGE_ARENA && \
+	K_DBM_VALUE_STORAGE != K_DBM_VALUE_STORAGE_SLAB
+#error "Unknown K_DBM_VALUE_STORAGE"
+#endif
+#if K_DBM_VALUE_STORAGE == K_DBM_VALUE_STORAGE_ARENA && !defined(K_DBM_VALUE_ARENA_SIZE)
+#error "Value arena size must be defined at compile time"
+#endif
+
+#if K_DBM_VALUE_STORAGE == K_DBM_VALUE_STORAGE_SLAB
+#if !defined(K_DBM_SLAB_CLASS_0_SIZE) || !defined(K_DBM_SLAB_CLASS_0_COUNT)
+#error "At least one slab class must be defined at compile time"
+#endif
+#ifndef K_DBM_SLAB_CLASS_1_SIZE
+#define K_DBM_SLAB_CLASS_1_SIZE	 0
+#define K_DBM_SLAB_CLASS_1_COUNT 0
+#endif
+#ifndef K_DBM_SLAB_CLASS_2_SIZE
+#define K_DBM_SLAB_CLASS_2_SIZE	 0
+#define K_DBM_SLAB_CLASS_2_COUNT 0
+#endif
+#ifndef K_DBM_SLAB_CLASS_3_SIZE
+#define K_DBM_SLAB_CLASS_3_SIZE	 0
+#define K_DBM_SLAB_CLASS_3_COUNT 0
+#endif
+#if (K_DBM_SLAB_CLASS_1_COUNT > 0 && K_DBM_SLAB_CLASS_1_SIZE <= K_DBM_SLAB_CLASS_0_SIZE) || \
+	(K_DBM_SLAB_CLASS_2_COUNT > 0 && K_DBM_SLAB_CLASS_2_SIZE <= K_DBM_SLAB_CLASS_1_SIZE) || \
+	(K_DBM_SLAB_CLASS_3_COUNT > 0 && K_DBM_SLAB_CLASS_3_SIZE <= K_DBM_SLAB_CLASS_2_SIZE)
+#error "Slab classes must be sorted by increasing size"
+#endif
+
+/**
+ * @brief Number of slab classes, unused classes have a count of 0
+ */
+#define K_DBM_SLAB_CLASS_MAX (4)
+
+/**
+ * @brief Size of the blocks of a slab class, rounded up to keep blocks 32 bit aligned
+ */
+#define K_DBM_SLAB_STRIDE(size) ((((size) + sizeof(uint32_t) - 1) / sizeof(uint32_t)) * sizeof(uint32_t))
+
+/**
+ * @brief Size in bytes of the storage shared by all the slab classes, laid out one class after the other
+ */
+#define K_DBM_SLAB_BUFFER_SIZE                                                                                         \
+	(K_DBM_SLAB_STRIDE(K_DBM_SLAB_CLASS_0_SIZE) * K_DBM_SLAB_CLASS_0_COUNT +                                           \
+	 K_DBM_SLAB_STRIDE(K_DBM_SLAB_CLASS_1_SIZE) * K_DBM_SLAB_CLASS_1_COUNT +                                           \
+	 K_DBM_SLAB_STRIDE(K_DBM_SLAB_CLASS_2_SIZE) * K_DBM_SLAB_CLASS_2_COUNT +                                           \
+	 K_DBM_SLAB_STRIDE(K_DBM_SLAB_CLASS_3_SIZE) * K_DBM_SLAB_CLASS_3_COUNT)
+#endif
+
+/**
+ * @brief Offset used to report a failed arena allocation
+ */
+#define K_DBM_ARENA_INVALID_OFFSET UINT32_MAX
+
+/**
+ * @brief Index strategies, selected at compile time with K_DBM_INDEX_STRATEGY
+ *
+ * - K_DBM_INDEX_HASH: open addressing hash table, O(1) expected lookups, best for large DBs
+ * - K_DBM_INDEX_FINGERPRINT: dense array of 1 byte key fingerprints scanned with SIMD (AVX2, SSE2 or NEON,
+ *   portable SWAR fallback), cheaper in memory for small and medium DBs but slower to look up than the hash index
+ */
+#define K_DBM_INDEX_HASH		(1)
+#define K_DBM_INDEX_FINGERPRINT (2)
+#ifndef K_DBM_INDEX_STRATEGY
+#define K_DBM_INDEX_STRATEGY K_DBM_INDEX_HASH
+#endif
+#if K_DBM_INDEX_STRATEGY != K_DBM_INDEX_HASH && K_DBM_INDEX_STRATEGY != K_DBM_INDEX_FINGERPRINT
+#error "Unknown K_DBM_INDEX_STRATEGY"
+#endif
+
+/**
+ * @brief Size of the fingerprint array, rounded up to the widest SIMD block
+ */
+#define K_DBM_FINGERPRINT_ARRAY_SIZE ((((K_DBM_DB_SIZE) + 31) / 32) * 32)
+
+/**
+ * @brief Fingerprint of a key hash, 0 is reserved for free entries
+ */
+#define K_DBM_FINGERPRINT(hash) ((uint8_t)(((hash) >> 24) ? ((hash) >> 24) : 1u))
+
+/**
+ * @brief Round a compile-time constant up to the next power of two
+ */
+#define K_DBM_SMEAR_1_(x)	(x) | ((x) >> 1)
+#define K_DBM_SMEAR_2_(x)	(K_DBM_SMEAR_1_(x)) | ((K_DBM_SMEAR_1_(x)) >> 2)
+#define K_DBM_SMEAR_4_(x)	(K_DBM_SMEAR_2_(x)) | ((K_DBM_SMEAR_2_(x)) >> 4)
+#define K_DBM_SMEAR_8_(x)	(K_DBM_SMEAR_4_(x)) | ((K_DBM_SMEAR_4_(x)) >> 8)
+#define K_DBM_SMEAR_16_(x)	(K_DBM_SMEAR_8_(x)) | ((K_DBM_SMEAR_8_(x)) >> 16)
+#define K_DBM_POW2_CEIL(x)	((K_DBM_SMEAR_16_((x) - 1)) + 1)
+
+/**
+ * @brief Number of buckets of the hash index
+ *
+ * The index is kept at a load factor of at most 50% so that linear probing stays short.
+ */
+#define K_DBM_HASH_INDEX_SIZE K_DBM_POW2_CEIL(2 * (K_DBM_DB_SIZE))
+#define K_DBM_HASH_INDEX_MASK (K_DBM_HASH_INDEX_SIZE - 1)
+
+/**
+ * @brief First byte of the NVM record of a typed value
+ *
+ * No string starts with a NULL byte, and a blob starting with one is saved with a second one, so a value written
+ * by k_dbm_insert or k_dbm_insert_blob can never be taken for a typed record.
+ */
+#define K_DBM_VALUE_RECORD_TAG 0x00
+
+/**
+ * @brief Maximum length of the NVM record of a typed value, tag and type bytes followed by the value in little endian order
+ */
+#define K_DBM_VALUE_RECORD_MAX_LENGTH (2 + sizeof(uint64_t))
 
 /* Typedef -------------------------------------------------------------------*/
+/**
+ * @brief Type used to reference an entry from the indexes
+ */
+#if K_DBM_DB_SIZE < UINT16_MAX
+typedef uint16_t k_dbm_slot_t;
+#else
+typedef uint32_t k_dbm_slot_t;
+#endif
+
+/**
+ * @brief Type of the value held by an entry
+ */
+typedef enum
+{
+	K_DBM_VALUE_TYPE_STRING,  //!< NULL terminated string
+	K_DBM_VALUE_TYPE_BLOB,	  //!< Binary data of explicit length
+	K_DBM_VALUE_TYPE_I32,	  //!< int32_t in native form
+	K_DBM_VALUE_TYPE_U64,	  //!< uint64_t in native form
+	K_DBM_VALUE_TYPE_F32,	  //!< float in native form
+	K_DBM_VALUE_TYPE_BOOL,	  //!< uint8_t, 0 or 1
+} k_dbm_value_type_t;
+
+/**
+ * @brief Fixed size arena with first fit allocation and coalescing of freed blocks
+ */
+typedef struct
+{
+	uint8_t *buffer_p;	 //!< Arena storage, 32 bit aligned
+	uint32_t size;		 //!< Arena size in bytes
+	uint32_t free_head;	 //!< Offset of the first free block, blocks are kept in address order
+	uint32_t used;		 //!< Bytes currently allocated, headers included
+} k_dbm_arena_t;
 
 /**
  * @brief DB entry structure
+ *
+ * Entries only hold metadata, values live in separate storage (see K_DBM_VALUE_STORAGE), so lookups,
+ * scans and free space accounting never load value bytes.
  */
 typedef struct
 {
 	const char	   *key;							//!< DB entry key
-	char			value[K_DBM_VALUE_MAX_LENGTH];	//!< DB entry value
+	uint32_t		key_hash;						//!< Hash of the key, compared before touching the key bytes
+	uint32_t		key_len;						//!< Length of the key, terminator excluded
+#if K_DBM_VALUE_STORAGE != K_DBM_VALUE_STORAGE_INLINE
+	uint32_t		value_offset;					//!< Offset of the value in the value arena or slab, only valid if value_len is not 0
+#endif
+	uint32_t		value_len;						//!< Length of the value, terminator excluded
 	k_dbm_storage_t storage;						//!< DB entry actual storage
+	uint8_t			value_type;						//!< k_dbm_value_type_t of the value
+	uint8_t			is_dirty;						//!< 1 if the value of a NVM entry is newer than its NVM copy
+	uint8_t			is_referenced;					//!< CLOCK reference bit, set when the entry is accessed
 } k_dbm_entry_t;
 
+/**
+ * @brief Key known to be absent from both RAM and NVM
+ */
+typedef struct
+{
+	uint32_t key_hash;									 //!< Hash of the key
+	uint16_t key_len;									 //!< Length of the key
+	uint8_t	 is_used;									 //!< 1 if the slot holds a key
+	char	 key[K_DBM_NEGATIVE_CACHE_KEY_MAX_LENGTH];	 //!< Copy of the key, not NULL terminated
+} k_dbm_negative_entry_t;
+
+/**
+ * @brief Keys to load into the cache by k_dbm_warmup or k_dbm_prefetch
+ */
+typedef struct
+{
+	const char *const *keys_p;		//!< Keys to load, NULL to enumerate the NVM keys
+	size_t			   key_count;	//!< Number of keys of keys_p
+	uint8_t			   is_pending;	//!< 1 while the job is scheduled or running
+	uint8_t			   is_warmup;	//!< 1 to stop once the DB is full instead of evicting entries
+} k_dbm_load_job_t;
+
+/**
+ * @brief Prefix deleted from NVM key by key by k_dbm_delete_prefix, while k_dbm_enumerate_f reports the NVM keys
+ */
+typedef struct
+{
+	const char *prefix_p;	 //!< Prefix of the keys to delete
+	size_t		prefix_len;	 //!< Length of the prefix
+	uint8_t		is_failed;	 //!< 1 if k_dbm_delete_f failed for a key
+} k_dbm_delete_prefix_ctx_t;
+
+/**
+ * @brief Deferred value written to NVM by a flush without holding the mutex
+ *
+ * While is_saving is set, writes of the key are deferred so they cannot reach NVM before the copy,
+ * and a delete of the key is repeated once the write is over.
+ */
+typedef struct
+{
+	char	 key_a[K_DBM_FLUSH_KEY_MAX_LENGTH];	  //!< Copy of the key, the entry may be deleted during the write
+	char	 value_a[K_DBM_VALUE_MAX_LENGTH];	  //!< Copy of the value
+	size_t	 key_len;							  //!< Length of the key, terminator excluded
+	size_t	 value_len;							  //!< Length of the value, terminator excluded
+	uint32_t key_hash;							  //!< Hash of the key
+	int		 db_index;							  //!< Entry of the value
+	uint8_t	 value_type;						  //!< k_dbm_value_type_t of the value
+	uint8_t	 is_saving;							  //!< 1 while the NVM write is in progress
+	uint8_t	 is_deleted;						  //!< 1 if the key has been deleted from NVM during the write
+} k_dbm_flush_save_t;
+
 /**
  *@brief DB structure
  */
 typedef struct
 {
-	k_dbm_entry_t entries_a[K_DBM_DB_SIZE];	 //!< DB entries
-	size_t		  db_size;					 //!< Max entries size
-	size_t		  db_count;					 //!< Number of entries currently in DB
+	k_dbm_entry_t entries_a[K_DBM_DB_SIZE];				 //!< DB entries
+#if K_DBM_INDEX_STRATEGY == K_DBM_INDEX_HASH
+	k_dbm_slot_t  hash_index_a[K_DBM_HASH_INDEX_SIZE];	 //!< Open addressing index over entries_a, stores entry index + 1 (0 means empty)
+#else
+	uint8_t		  fingerprints_a[K_DBM_FINGERPRINT_ARRAY_SIZE];	 //!< Key fingerprint of each entry of entries_a, 0 means not indexed
+#endif
+	k_dbm_slot_t  free_slots_a[K_DBM_DB_SIZE];			 //!< Stack of free entries, the first (db_size - db_count) elements are valid
+	k_dbm_slot_t  ordered_index_a[K_DBM_DB_SIZE];		 //!< Indexes of the keyed entries, sorted by key
+	size_t		  ordered_count;						 //!< Number of valid elements of ordered_index_a
+	size_t		  db_size;								 //!< Max number of runtime key entries
+	size_t		  db_count;								 //!< Number of runtime key entries currently in DB
+	size_t		  dirty_count;							 //!< Number of entries whose value still has to be saved in NVM
+	uint32_t	  dirty_since_a[K_DBM_DB_SIZE];			 //!< Time at which each dirty entry has been written first, start of its coalescing window
+#if K_DBM_NVM_CACHE_EVICTION
+	size_t		  clock_hand;							 //!< Next entry examined by the eviction
+#endif
+#if K_DBM_ADMISSION_SKETCH_SIZE > 0
+	uint8_t	 admission_sketch_a[(K_DBM_ADMISSION_SKETCH_SIZE + 1) / 2];	 //!< Read frequency sketch, two 4 bit counters per byte
+	uint32_t admission_samples;											 //!< Reads counted since the last halving
+#endif
+	k_dbm_stats_t	   stats;				//!< Cache statistics
+	k_dbm_load_job_t   warmup_job;			//!< Job of k_dbm_warmup
+	k_dbm_load_job_t   prefetch_job;		//!< Job of k_dbm_prefetch
+	k_dbm_flush_save_t flush_save;			//!< Value being written to NVM by a flush
+	uint32_t		   nvm_epoch;			//!< Incremented by every NVM write or delete, lets a load read NVM without holding the mutex
+	uint32_t		   dirty_since_ms;		//!< Time at which the oldest dirty value has been written, recomputed by every flush
+	size_t			   flush_failed_count;	//!< Values left dirty by failed saves of the last flush, not counted towards write_back_dirty_max
+	uint32_t		   flush_min_age_ms;	//!< Age of the values saved by the scheduled flush, 0 for all of them
+	uint8_t			   is_flush_pending;	//!< 1 while a write-back flush is scheduled
+	uint8_t			   is_shut_down;		//!< 1 after k_dbm_shutdown, NVM writes are no longer deferred
+#if K_DBM_KEY_ARENA_SIZE > 0
+	uint32_t	  key_arena_buffer_a[(K_DBM_KEY_ARENA_SIZE + sizeof(uint32_t) - 1) / sizeof(uint32_t)];	 //!< Key arena storage
+	k_dbm_arena_t key_arena;																		 //!< Owned copies of the entry keys
+#endif
+#if K_DBM_VALUE_STORAGE == K_DBM_VALUE_STORAGE_INLINE
+	char		  values_a[K_DBM_DB_SIZE][K_DBM_VALUE_MAX_LENGTH];	//!< Value of each entry of entries_a, kept apart from the metadata
+#elif K_DBM_VALUE_STORAGE == K_DBM_VALUE_STORAGE_ARENA
+	uint32_t	  value_arena_buffer_a[(K_DBM_VALUE_ARENA_SIZE + sizeof(uint32_t) - 1) / sizeof(uint32_t)];	 //!< Value arena storage
+	k_dbm_arena_t value_arena;																			 //!< NULL terminated entry values
+#elif K_DBM_VALUE_STORAGE == K_DBM_VALUE_STORAGE_SLAB
+	uint32_t value_slab_buffer_a[K_DBM_SLAB_BUFFER_SIZE / sizeof(uint32_t)];  //!< Slab storage, holds NULL terminated entry values
+	uint32_t value_slab_free_a[K_DBM_SLAB_CLASS_MAX];						   //!< Offset of the first free block of each class
+#endif
+#if K_DBM_NEGATIVE_CACHE_SIZE > 0
+	k_dbm_negative_entry_t negative_cache_a[K_DBM_NEGATIVE_CACHE_SIZE];	 //!< Ring of keys known to be absent
+	size_t				   negative_cache_next;							 //!< Slot overwritten by the next miss, the oldest one
+#endif
+#if K_DBM_NVM_FILTER_SIZE > 0
+	uint8_t nvm_filter_a[(K_DBM_NVM_FILTER_SIZE + 1) / 2];	//!< Counting Bloom filter over the NVM keys, two 4 bit counters per byte
+	uint8_t nvm_filter_is_ready;							//!< 1 if the filter covers every NVM key
+#endif
 } k_dbm_db_t;
 
 /**
@@ -56,14 +435,276 @@ typedef struct
 
 /* Constant ------------------------------------------------------------------*/
 /* Variable ------------------------------------------------------------------*/
+extern k_dbm_context_t k_dbm_context;
+
 /* Function Declaration ------------------------------------------------------*/
 /**
- * @brief Return the first free entry in DB
+ * @brief Return the free entry that will be used by the next allocation
  *
- * @return -1 if no entry is free, first free entry otherwise
+ * @return -1 if no entry is free, next free entry otherwise
  */
 int k_dbm_find_first_empty_entry(void);
 
+/**
+ * @brief Take an entry from the free stack, add it to the hash index and account it in db_count
+ *
+ * When the key arena is enabled the key is copied into it.
+ *
+ * @param key_p Key of the new entry
+ * @param key_len Length of the key
+ * @param hash Hash of the key
+ * @param storage Storage of the new entry
+ * @param bucket Free bucket returned by a k_dbm_index_lookup miss on key_p
+ *
+ * @return Index of the allocated entry, -1 if DB is full
+ */
+int k_dbm_alloc_entry(const char *key_p, size_t key_len, uint32_t hash, k_dbm_storage_t storage, size_t bucket);
+
+/**
+ * @brief Add an entry to the ordered index
+ *
+ * @param db_index Index of the entry in entries_a, its key must be set
+ */
+void k_dbm_ordered_insert(int db_index);
+
+/**
+ * @brief Remove an entry from the ordered index
+ *
+ * @param db_index Index of the entry in entries_a, its key must still be set
+ */
+void k_dbm_ordered_remove(int db_index);
+
+/**
+ * @brief Find the first position of the ordered index whose key is not lower than a given key
+ *
+ * @param key_p Key to search for, not necessarily NULL terminated
+ * @param key_len Length of the key
+ *
+ * @return Position in ordered_index_a, ordered_count if all keys are lower
+ */
+size_t k_dbm_ordered_lower_bound(const char *key_p, size_t key_len);
+
+/**
+ * @brief Initialize an arena over a caller provided buffer
+ *
+ * @param arena_p Arena to initialize
+ * @param buffer_p 32 bit aligned storage
+ * @param buffer_size Size of the storage in bytes
+ */
+void k_dbm_arena_init(k_dbm_arena_t *arena_p, uint32_t *buffer_p, size_t buffer_size);
+
+/**
+ * @brief Allocate a block from an arena
+ *
+ * @param arena_p Arena to allocate from
+ * @param size Requested size in bytes
+ *
+ * @return Offset of the allocated block, K_DBM_ARENA_INVALID_OFFSET if no free block is large enough
+ */
+uint32_t k_dbm_arena_alloc(k_dbm_arena_t *arena_p, size_t size);
+
+/**
+ * @brief Give a block back to an arena, merging it with adjacent free blocks
+ *
+ * @param arena_p Arena the block belongs to
+ * @param offset Offset returned by k_dbm_arena_alloc, K_DBM_ARENA_INVALID_OFFSET is ignored
+ */
+void k_dbm_arena_free(k_dbm_arena_t *arena_p, uint32_t offset);
+
+/**
+ * @brief Shrink an allocated block in place, giving its tail back to the arena
+ *
+ * @param arena_p Arena the block belongs to
+ * @param offset Offset returned by k_dbm_arena_alloc
+ * @param size New size in bytes, not greater than the block capacity
+ */
+void k_dbm_arena_shrink(k_dbm_arena_t *arena_p, uint32_t offset, size_t size);
+
+/**
+ * @brief Get the number of bytes usable in an allocated block
+ *
+ * @param arena_p Arena the block belongs to
+ * @param offset Offset returned by k_dbm_arena_alloc
+ *
+ * @return Block capacity in bytes, at least the size requested on allocation
+ */
+size_t k_dbm_arena_capacity(const k_dbm_arena_t *arena_p, uint32_t offset);
+
+/**
+ * @brief Convert an arena offset to a pointer
+ *
+ * @param arena_p Arena the block belongs to
+ * @param offset Offset returned by k_dbm_arena_alloc
+ *
+ * @return Pointer to the block
+ */
+void *k_dbm_arena_ptr(const k_dbm_arena_t *arena_p, uint32_t offset);
+
+/**
+ * @brief Remove an entry from the hash index, clear it and give it back to the free stack
+ *
+ * @note Entries of static keys are only cleared, they keep their key and stay indexed
+ *
+ * @param db_index Index of the entry to release
+ */
+void k_dbm_free_entry(int db_index);
+
+/**
+ * @brief Link every slab block in the free list of its class
+ */
+void k_dbm_slab_init(void);
+
+/**
+ * @brief Allocate a block from the smallest slab class that fits and still has a free block
+ *
+ * @param size Requested size in bytes
+ *
+ * @return Offset of the block in the slab storage, K_DBM_ARENA_INVALID_OFFSET if no class can hold it
+ */
+uint32_t k_dbm_slab_alloc(size_t size);
+
+/**
+ * @brief Give a block back to its slab class
+ *
+ * @param offset Offset returned by k_dbm_slab_alloc
+ */
+void k_dbm_slab_free(uint32_t offset);
+
+/**
+ * @brief Get the size of the blocks of the class owning a block
+ *
+ * @param offset Offset returned by k_dbm_slab_alloc
+ *
+ * @return Block capacity in bytes
+ */
+size_t k_dbm_slab_capacity(uint32_t offset);
+
+/**
+ * @brief Get the size of the blocks of the smallest class able to hold a value, regardless of free blocks
+ *
+ * @param size Requested size in bytes
+ *
+ * @return Block capacity in bytes, 0 if no class is large enough
+ */
+size_t k_dbm_slab_fit(size_t size);
+
+/**
+ * @brief Convert a slab offset to a pointer
+ *
+ * @param offset Offset returned by k_dbm_slab_alloc
+ *
+ * @return Pointer to the block
+ */
+void *k_dbm_slab_ptr(uint32_t offset);
+
+/**
+ * @brief Get the value of an entry
+ *
+ * @param db_index Index of the entry
+ *
+ * @return NULL terminated value, empty if the entry has no value
+ */
+const char *k_dbm_value_get(int db_index);
+
+/**
+ * @brief Get the length of the value of an entry
+ *
+ * @param db_index Index of the entry
+ *
+ * @return Length of the value, terminator excluded
+ */
+size_t k_dbm_value_length(int db_index);
+
+/**
+ * @brief Store the value of an entry
+ *
+ * A terminator is always stored after the value, so string values can be returned as is.
+ *
+ * @param db_index Index of the entry
+ * @param value_p Value, only value_len bytes are read
+ * @param value_len Length of the value, terminator excluded
+ * @param value_type Type of the value
+ *
+ * @return 0 in case of success, -1 if the value is too long or the value storage is full. On failure the
+ *         previous value is kept
+ */
+int k_dbm_value_set(int db_index, const void *value_p, size_t value_len, k_dbm_value_type_t value_type);
+
+/**
+ * @brief Release the value of an entry
+ *
+ * @param db_index Index of the entry
+ */
+void k_dbm_value_clear(int db_index);
+
+/**
+ * @brief Compare the value of an entry with a new one
+ *
+ * @param db_index Index of the entry
+ * @param value_p Value to compare
+ * @param value_len Length of the value, terminator excluded
+ * @param value_type Type of the value
+ *
+ * @return 1 if the entry holds the same value with the same type, 0 otherwise
+ */
+int k_dbm_value_equals(int db_index, const void *value_p, size_t value_len, k_dbm_value_type_t value_type);
+
+/**
+ * @brief Get the size of a typed value in native form
+ *
+ * @param value_type Type of the value
+ *
+ * @return Size in bytes, 0 for strings and blobs
+ */
+size_t k_dbm_value_type_size(k_dbm_value_type_t value_type);
+
+/**
+ * @brief Encode a typed value into its NVM record
+ *
+ * @param value_type Type of the value, must be a typed one
+ * @param value_p Value in native form
+ * @param record_p Buffer receiving the record, at least K_DBM_VALUE_RECORD_MAX_LENGTH bytes
+ *
+ * @return Length of the record
+ */
+size_t k_dbm_value_encode(k_dbm_value_type_t value_type, const void *value_p, uint8_t *record_p);
+
+/**
+ * @brief Decode a NVM record into a typed value
+ *
+ * @param record_p Record read from NVM
+ * @param record_len Length of the record
+ * @param value_type Expected type of the value
+ * @param value_p Receives the value in native form
+ *
+ * @return 0 in case of success, -1 if the data is not a record of a value of the expected type
+ */
+int k_dbm_value_decode(const uint8_t *record_p, size_t record_len, k_dbm_value_type_t value_type, void *value_p);
+
+/**
+ * @brief Format a typed value as a NULL terminated decimal string
+ *
+ * @param value_p Value in native form
+ * @param value_type Type of the value, must be a typed one
+ * @param buffer_p Buffer receiving the string
+ * @param buffer_size Size of the buffer
+ * @param value_len_p Receives the length of the string, terminator excluded
+ *
+ * @return 0 in case of success, -1 if the buffer is too small
+ */
+int k_dbm_value_format(const void *value_p, k_dbm_value_type_t value_type, char *buffer_p, size_t buffer_size, size_t *value_len_p);
+
+/**
+ * @brief Parse a string holding a decimal integer, e.g. a counter saved with k_dbm_insert
+ *
+ * @param value_p String, an optional '-' followed by digits only
+ * @param value_len Length of the string, terminator excluded
+ * @param result_p Receives the integer
+ *
+ * @return 0 in case of success, -1 if the string is not a decimal integer or does not fit an int64_t
+ */
+int k_dbm_value_parse_i64(const char *value_p, size_t value_len, int64_t *result_p);
+
 /**
  * @brief Find an entry by key in DB
  *
@@ -73,6 +714,151 @@ int k_dbm_find_first_empty_entry(void);
  */
 int k_dbm_find_entry(const char *key_p);
 
+/**
+ * @brief Count a read of a key in the admission sketch
+ *
+ * @param hash Hash of the key
+ */
+void k_dbm_admission_record(uint32_t hash);
+
+/**
+ * @brief Decide whether a key read from NVM may replace a cached entry
+ *
+ * @param candidate_hash Hash of the key to cache
+ * @param victim_hash Hash of the key of the entry that would be evicted
+ *
+ * @return 1 if the candidate is read more often than the victim or the admission policy is disabled, 0 otherwise
+ */
+int k_dbm_admission_admit(uint32_t candidate_hash, uint32_t victim_hash);
+
+/**
+ * @brief Record an access to an entry for the eviction policy
+ *
+ * @param db_index Index of the entry
+ */
+void k_dbm_eviction_touch(int db_index);
+
+/**
+ * @brief Free a clean NVM entry to make room in a full DB
+ *
+ * @param hash Hash of the key that needs the room, checked against the victim by the admission policy
+ * @param is_hint 1 if the caller asked for the key to be cached, the admission policy is bypassed
+ *
+ * @return 0 if an entry has been freed, -1 if no entry can be evicted, the admission policy rejected the key or eviction is disabled
+ */
+int k_dbm_eviction_evict(uint32_t hash, int is_hint);
+
+/**
+ * @brief Check whether a key is remembered as absent from NVM
+ *
+ * @param key_p Key to search for
+ * @param key_len Length of the key
+ * @param hash Hash of the key
+ *
+ * @return 1 if the key is known to be absent, 0 otherwise
+ */
+int k_dbm_negative_cache_contains(const char *key_p, size_t key_len, uint32_t hash);
+
+/**
+ * @brief Remember a key that is absent from NVM, replacing the oldest one if the cache is full
+ *
+ * @param key_p Key to remember
+ * @param key_len Length of the key
+ * @param hash Hash of the key
+ */
+void k_dbm_negative_cache_add(const char *key_p, size_t key_len, uint32_t hash);
+
+/**
+ * @brief Forget a key, to be called whenever the key is inserted
+ *
+ * @param key_p Key to forget
+ * @param key_len Length of the key
+ * @param hash Hash of the key
+ */
+void k_dbm_negative_cache_remove(const char *key_p, size_t key_len, uint32_t hash);
+
+/**
+ * @brief Build the NVM key filter from k_dbm_enumerate_f, called by k_dbm_init
+ */
+void k_dbm_nvm_filter_init(void);
+
+/**
+ * @brief Account a key that has been written to NVM
+ *
+ * @param hash Hash of the key
+ */
+void k_dbm_nvm_filter_add(uint32_t hash);
+
+/**
+ * @brief Account a key that has been deleted from NVM
+ *
+ * @param hash Hash of the key, it must have been added before
+ */
+void k_dbm_nvm_filter_remove(uint32_t hash);
+
+/**
+ * @brief Check whether a key may be stored in NVM
+ *
+ * @param hash Hash of the key
+ *
+ * @return 0 if the key is certainly not in NVM, 1 if it may be
+ */
+int k_dbm_nvm_filter_may_contain(uint32_t hash);
+
+/**
+ * @brief Compute the hash and the length of a key in a single pass
+ *
+ * @param key_p NULL terminated key
+ * @param key_len_p Filled with the key length, terminator excluded
+ *
+ * @return 32 bit FNV-1a hash of the key
+ */
+uint32_t k_dbm_hash_key(const char *key_p, size_t *key_len_p);
+
+/**
+ * @brief Scramble a key hash, to derive a second independent looking hash from it
+ *
+ * @param hash Key hash
+ *
+ * @return Mixed hash
+ */
+uint32_t k_dbm_hash_mix(uint32_t hash);
+
+/**
+ * @brief Probe the hash index for a key
+ *
+ * A single probe serves both lookups and insertions: when the key is not found, the probe stops on the
+ * empty bucket where the key has to be linked. With the fingerprint index the bucket is not used.
+ *
+ * @param key_p Key to search for
+ * @param key_len Length of the key, as returned by k_dbm_hash_key
+ * @param hash Hash of the key, as returned by k_dbm_hash_key
+ * @param bucket_p Filled with the bucket of the entry, or with the free bucket for the key if it is not found
+ *
+ * @return Index of the entry if found, -1 otherwise
+ */
+int k_dbm_index_lookup(const char *key_p, size_t key_len, uint32_t hash, size_t *bucket_p);
+
+/**
+ * @brief Link an entry in the hash index
+ *
+ * @note The bucket must be the one returned by a k_dbm_index_lookup miss on the entry key,
+ *       with no index modification in between
+ *
+ * @param db_index Index of the entry in entries_a
+ * @param bucket Free bucket returned by k_dbm_index_lookup
+ */
+void k_dbm_index_insert(int db_index, size_t bucket);
+
+/**
+ * @brief Remove an entry from the hash index
+ *
+ * @note Must be called before the entry key is cleared
+ *
+ * @param db_index Index of the entry in entries_a
+ */
+void k_dbm_index_remove(int db_index);
+
 #ifdef __cplusplus
 }
 #endif
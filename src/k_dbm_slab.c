@@ -0,0 +1,114 @@
+/**
+ * @file k_dbm_slab.c
+ * @ingroup k_dbm
+ * @{
+ */
+
+/* Include -------------------------------------------------------------------*/
+#include <string.h>
+
+#include "k_dbm_priv.h"
+
+#if K_DBM_VALUE_STORAGE == K_DBM_VALUE_STORAGE_SLAB
+/* Macro ---------------------------------------------------------------------*/
+#define K_DBM_SLAB_CLASS_0_BASE (0)
+#define K_DBM_SLAB_CLASS_1_BASE (K_DBM_SLAB_CLASS_0_BASE + K_DBM_SLAB_STRIDE(K_DBM_SLAB_CLASS_0_SIZE) * K_DBM_SLAB_CLASS_0_COUNT)
+#define K_DBM_SLAB_CLASS_2_BASE (K_DBM_SLAB_CLASS_1_BASE + K_DBM_SLAB_STRIDE(K_DBM_SLAB_CLASS_1_SIZE) * K_DBM_SLAB_CLASS_1_COUNT)
+#define K_DBM_SLAB_CLASS_3_BASE (K_DBM_SLAB_CLASS_2_BASE + K_DBM_SLAB_STRIDE(K_DBM_SLAB_CLASS_2_SIZE) * K_DBM_SLAB_CLASS_2_COUNT)
+
+/* Typedef -------------------------------------------------------------------*/
+/**
+ * @brief Layout of a slab class
+ */
+typedef struct
+{
+	uint32_t size;	 //!< Block size in bytes
+	uint32_t count;	 //!< Number of blocks
+	uint32_t base;	 //!< Offset of the first block in the slab storage
+} k_dbm_slab_class_t;
+
+/* Function Declaration ------------------------------------------------------*/
+static size_t	 k_dbm_slab_class_of(uint32_t offset);
+static uint32_t *k_dbm_slab_link(uint32_t offset);
+
+/* Constant ------------------------------------------------------------------*/
+static const k_dbm_slab_class_t k_dbm_slab_classes_a[K_DBM_SLAB_CLASS_MAX] = {
+	{K_DBM_SLAB_STRIDE(K_DBM_SLAB_CLASS_0_SIZE), K_DBM_SLAB_CLASS_0_COUNT, K_DBM_SLAB_CLASS_0_BASE},
+	{K_DBM_SLAB_STRIDE(K_DBM_SLAB_CLASS_1_SIZE), K_DBM_SLAB_CLASS_1_COUNT, K_DBM_SLAB_CLASS_1_BASE},
+	{K_DBM_SLAB_STRIDE(K_DBM_SLAB_CLASS_2_SIZE), K_DBM_SLAB_CLASS_2_COUNT, K_DBM_SLAB_CLASS_2_BASE},
+	{K_DBM_SLAB_STRIDE(K_DBM_SLAB_CLASS_3_SIZE), K_DBM_SLAB_CLASS_3_COUNT, K_DBM_SLAB_CLASS_3_BASE},
+};
+
+/* Variable ------------------------------------------------------------------*/
+/* Function Definition -------------------------------------------------------*/
+void k_dbm_slab_init(void)
+{
+	for (size_t i = 0; i < K_DBM_SLAB_CLASS_MAX; i++)
+	{
+		const k_dbm_slab_class_t *class_p = &k_dbm_slab_classes_a[i];
+		k_dbm_context.db.value_slab_free_a[i] = K_DBM_ARENA_INVALID_OFFSET;
+		/* Push from the last block, so the first block of the class is allocated first */
+		for (uint32_t block = class_p->count; block > 0; block--)
+		{
+			const uint32_t offset				  = class_p->base + (block - 1) * class_p->size;
+			*k_dbm_slab_link(offset)			  = k_dbm_context.db.value_slab_free_a[i];
+			k_dbm_context.db.value_slab_free_a[i] = offset;
+		}
+	}
+}
+
+uint32_t k_dbm_slab_alloc(size_t size)
+{
+	uint32_t offset = K_DBM_ARENA_INVALID_OFFSET;
+	/* Classes are sorted by size, a full class spills into the next larger one */
+	for (size_t i = 0; i < K_DBM_SLAB_CLASS_MAX && K_DBM_ARENA_INVALID_OFFSET == offset; i++)
+	{
+		if (k_dbm_slab_classes_a[i].size >= size && K_DBM_ARENA_INVALID_OFFSET != k_dbm_context.db.value_slab_free_a[i])
+		{
+			offset								  = k_dbm_context.db.value_slab_free_a[i];
+			k_dbm_context.db.value_slab_free_a[i] = *k_dbm_slab_link(offset);
+		}
+	}
+	return offset;
+}
+
+void k_dbm_slab_free(uint32_t offset)
+{
+	const size_t slab_class				  = k_dbm_slab_class_of(offset);
+	*k_dbm_slab_link(offset)			  = k_dbm_context.db.value_slab_free_a[slab_class];
+	k_dbm_context.db.value_slab_free_a[slab_class] = offset;
+}
+
+size_t k_dbm_slab_capacity(uint32_t offset) { return k_dbm_slab_classes_a[k_dbm_slab_class_of(offset)].size; }
+
+size_t k_dbm_slab_fit(size_t size)
+{
+	size_t capacity = 0;
+	for (size_t i = 0; i < K_DBM_SLAB_CLASS_MAX && 0 == capacity; i++)
+	{
+		if (k_dbm_slab_classes_a[i].count > 0 && k_dbm_slab_classes_a[i].size >= size)
+		{
+			capacity = k_dbm_slab_classes_a[i].size;
+		}
+	}
+	return capacity;
+}
+
+void *k_dbm_slab_ptr(uint32_t offset) { return (uint8_t *)k_dbm_context.db.value_slab_buffer_a + offset; }
+
+static size_t k_dbm_slab_class_of(uint32_t offset)
+{
+	size_t slab_class = K_DBM_SLAB_CLASS_MAX - 1;
+	while (slab_class > 0 && (0 == k_dbm_slab_classes_a[slab_class].count || offset < k_dbm_slab_classes_a[slab_class].base))
+	{
+		slab_class--;
+	}
+	return slab_class;
+}
+
+static uint32_t *k_dbm_slab_link(uint32_t offset)
+{
+	/* Free blocks hold the offset of the next free block of their class */
+	return (uint32_t *)k_dbm_slab_ptr(offset);
+}
+#endif
@@ -0,0 +1,315 @@
+/**
+ * @file k_dbm_value.c
+ * @ingroup k_dbm
+ * @{
+ */
+
+/* Include -------------------------------------------------------------------*/
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "k_dbm_priv.h"
+
+/* Macro ---------------------------------------------------------------------*/
+/* Typedef -------------------------------------------------------------------*/
+/* Function Declaration ------------------------------------------------------*/
+#if K_DBM_VALUE_STORAGE != K_DBM_VALUE_STORAGE_INLINE
+static void		k_dbm_value_write_in_place(k_dbm_entry_t *entry_p, const void *value_p, size_t value_len);
+static void	   *k_dbm_value_ptr(uint32_t value_offset);
+static uint32_t k_dbm_value_alloc(size_t size);
+static void		k_dbm_value_release(uint32_t value_offset);
+static size_t	k_dbm_value_capacity(uint32_t value_offset);
+static int		k_dbm_value_keeps_block(uint32_t value_offset, size_t size);
+#endif
+
+/* Constant ------------------------------------------------------------------*/
+/* Variable ------------------------------------------------------------------*/
+/* Function Definition -------------------------------------------------------*/
+size_t k_dbm_value_length(int db_index) { return k_dbm_context.db.entries_a[db_index].value_len; }
+
+size_t k_dbm_value_type_size(k_dbm_value_type_t value_type)
+{
+	size_t size = 0;
+	switch (value_type)
+	{
+		case K_DBM_VALUE_TYPE_I32:
+		case K_DBM_VALUE_TYPE_F32:
+			size = sizeof(uint32_t);
+			break;
+		case K_DBM_VALUE_TYPE_U64:
+			size = sizeof(uint64_t);
+			break;
+		case K_DBM_VALUE_TYPE_BOOL:
+			size = sizeof(uint8_t);
+			break;
+		default:
+			break;
+	}
+	return size;
+}
+
+size_t k_dbm_value_encode(k_dbm_value_type_t value_type, const void *value_p, uint8_t *record_p)
+{
+	const size_t size = k_dbm_value_type_size(value_type);
+	uint64_t	 bits = 0;
+	if (sizeof(uint64_t) == size)
+	{
+		memcpy(&bits, value_p, size);
+	}
+	else if (sizeof(uint32_t) == size)
+	{
+		uint32_t value = 0;
+		memcpy(&value, value_p, size);
+		bits = value;
+	}
+	else
+	{
+		bits = *(const uint8_t *)value_p;
+	}
+	/* Little endian whatever the host, so the record can be read back by another target */
+	record_p[0] = K_DBM_VALUE_RECORD_TAG;
+	record_p[1] = (uint8_t)value_type;
+	for (size_t i = 0; i < size; i++)
+	{
+		record_p[2 + i] = (uint8_t)(bits >> (8 * i));
+	}
+	return 2 + size;
+}
+
+int k_dbm_value_decode(const uint8_t *record_p, size_t record_len, k_dbm_value_type_t value_type, void *value_p)
+{
+	int			 ret_code = -1;
+	const size_t size	  = k_dbm_value_type_size(value_type);
+	if (size && 2 + size == record_len && K_DBM_VALUE_RECORD_TAG == record_p[0] && (uint8_t)value_type == record_p[1])
+	{
+		uint64_t bits = 0;
+		for (size_t i = 0; i < size; i++)
+		{
+			bits |= (uint64_t)record_p[2 + i] << (8 * i);
+		}
+		if (sizeof(uint64_t) == size)
+		{
+			memcpy(value_p, &bits, size);
+		}
+		else if (sizeof(uint32_t) == size)
+		{
+			const uint32_t value = (uint32_t)bits;
+			memcpy(value_p, &value, size);
+		}
+		else
+		{
+			*(uint8_t *)value_p = (uint8_t)bits;
+		}
+		ret_code = 0;
+	}
+	return ret_code;
+}
+
+int k_dbm_value_equals(int db_index, const void *value_p, size_t value_len, k_dbm_value_type_t value_type)
+{
+	const k_dbm_entry_t *entry_p = &k_dbm_context.db.entries_a[db_index];
+	return (uint8_t)value_type == entry_p->value_type && value_len == entry_p->value_len && 0 == memcmp(k_dbm_value_get(db_index), value_p, value_len);
+}
+
+int k_dbm_value_format(const void *value_p, k_dbm_value_type_t value_type, char *buffer_p, size_t buffer_size, size_t *value_len_p)
+{
+	int ret_code = -1;
+	int length	 = -1;
+	switch (value_type)
+	{
+		case K_DBM_VALUE_TYPE_I32:
+		{
+			int32_t value = 0;
+			memcpy(&value, value_p, sizeof(value));
+			length = snprintf(buffer_p, buffer_size, "%" PRId32, value);
+			break;
+		}
+		case K_DBM_VALUE_TYPE_U64:
+		{
+			uint64_t value = 0;
+			memcpy(&value, value_p, sizeof(value));
+			length = snprintf(buffer_p, buffer_size, "%" PRIu64, value);
+			break;
+		}
+		case K_DBM_VALUE_TYPE_F32:
+		{
+			float value = 0;
+			memcpy(&value, value_p, sizeof(value));
+			/* 9 significant digits read back to the same float */
+			length = snprintf(buffer_p, buffer_size, "%.9g", (double)value);
+			break;
+		}
+		case K_DBM_VALUE_TYPE_BOOL:
+			length = snprintf(buffer_p, buffer_size, "%u", (unsigned)*(const uint8_t *)value_p);
+			break;
+		default:
+			break;
+	}
+	if (length >= 0)
+	{
+		*value_len_p = (size_t)length;
+		ret_code	 = (size_t)length < buffer_size ? 0 : -1;
+	}
+	return ret_code;
+}
+
+int k_dbm_value_parse_i64(const char *value_p, size_t value_len, int64_t *result_p)
+{
+	int			   ret_code	 = -1;
+	const size_t   sign_len	 = value_len && '-' == value_p[0];
+	const uint64_t limit	 = sign_len ? (uint64_t)INT64_MAX + 1 : (uint64_t)INT64_MAX;
+	uint64_t	   magnitude = 0;
+	size_t		   position	 = sign_len;
+	/* Stop at the first character that is not a digit, or before the magnitude exceeds the limit */
+	while (position < value_len && value_p[position] >= '0' && value_p[position] <= '9' &&
+		   magnitude <= (limit - (uint64_t)(value_p[position] - '0')) / 10)
+	{
+		magnitude = magnitude * 10 + (uint64_t)(value_p[position] - '0');
+		position++;
+	}
+	if (position == value_len && value_len > sign_len)
+	{
+		/* INT64_MIN has no positive counterpart */
+		*result_p = sign_len && magnitude ? -(int64_t)(magnitude - 1) - 1 : (int64_t)magnitude;
+		ret_code  = 0;
+	}
+	return ret_code;
+}
+
+#if K_DBM_VALUE_STORAGE == K_DBM_VALUE_STORAGE_INLINE
+const char *k_dbm_value_get(int db_index) { return k_dbm_context.db.values_a[db_index]; }
+
+int k_dbm_value_set(int db_index, const void *value_p, size_t value_len, k_dbm_value_type_t value_type)
+{
+	int			   ret_code = -1;
+	k_dbm_entry_t *entry_p	= &k_dbm_context.db.entries_a[db_index];
+	char		  *stored_p = k_dbm_context.db.values_a[db_index];
+	if (value_len < K_DBM_VALUE_MAX_LENGTH)
+	{
+		memcpy(stored_p, value_p, value_len);
+		stored_p[value_len] = '\0';
+		if (entry_p->value_len > value_len)
+		{
+			/* Clear the tail of the previous value, so that clearing only has to cover the current length */
+			memset(stored_p + value_len + 1, 0, entry_p->value_len - value_len);
+		}
+		entry_p->value_len	= (uint32_t)value_len;
+		entry_p->value_type = (uint8_t)value_type;
+		ret_code			= 0;
+	}
+	return ret_code;
+}
+
+void k_dbm_value_clear(int db_index)
+{
+	k_dbm_entry_t *entry_p = &k_dbm_context.db.entries_a[db_index];
+	memset(k_dbm_context.db.values_a[db_index], 0, entry_p->value_len);
+	entry_p->value_len	= 0;
+	entry_p->value_type = K_DBM_VALUE_TYPE_STRING;
+}
+#else
+const char *k_dbm_value_get(int db_index)
+{
+	const k_dbm_entry_t *entry_p = &k_dbm_context.db.entries_a[db_index];
+	const char			*value_p = "";
+	if (entry_p->value_len)
+	{
+		value_p = k_dbm_value_ptr(entry_p->value_offset);
+	}
+	return value_p;
+}
+
+int k_dbm_value_set(int db_index, const void *value_p, size_t value_len, k_dbm_value_type_t value_type)
+{
+	int			   ret_code = -1;
+	k_dbm_entry_t *entry_p	= &k_dbm_context.db.entries_a[db_index];
+	if (value_len < K_DBM_VALUE_MAX_LENGTH)
+	{
+		uint32_t value_offset = K_DBM_ARENA_INVALID_OFFSET;
+		if (0 == value_len)
+		{
+			/* Empty values do not take any storage */
+			k_dbm_value_clear(db_index);
+			ret_code = 0;
+		}
+		else if (entry_p->value_len && k_dbm_value_keeps_block(entry_p->value_offset, value_len + 1))
+		{
+			k_dbm_value_write_in_place(entry_p, value_p, value_len);
+			ret_code = 0;
+		}
+		else if (K_DBM_ARENA_INVALID_OFFSET != (value_offset = k_dbm_value_alloc(value_len + 1)))
+		{
+			/* Allocate before releasing, so the previous value survives a full storage */
+			char *stored_p = k_dbm_value_ptr(value_offset);
+			memcpy(stored_p, value_p, value_len);
+			stored_p[value_len] = '\0';
+			k_dbm_value_clear(db_index);
+			entry_p->value_offset = value_offset;
+			entry_p->value_len	  = (uint32_t)value_len;
+			ret_code			  = 0;
+		}
+		else if (entry_p->value_len && value_len < k_dbm_value_capacity(entry_p->value_offset))
+		{
+			/* No better block is free, the current one still holds the value */
+			k_dbm_value_write_in_place(entry_p, value_p, value_len);
+			ret_code = 0;
+		}
+		if (0 == ret_code)
+		{
+			entry_p->value_type = (uint8_t)value_type;
+		}
+	}
+	return ret_code;
+}
+
+void k_dbm_value_clear(int db_index)
+{
+	k_dbm_entry_t *entry_p = &k_dbm_context.db.entries_a[db_index];
+	if (entry_p->value_len)
+	{
+		k_dbm_value_release(entry_p->value_offset);
+	}
+	entry_p->value_offset = 0;
+	entry_p->value_len	  = 0;
+	entry_p->value_type	  = K_DBM_VALUE_TYPE_STRING;
+}
+
+static void k_dbm_value_write_in_place(k_dbm_entry_t *entry_p, const void *value_p, size_t value_len)
+{
+	char *stored_p = k_dbm_value_ptr(entry_p->value_offset);
+	memcpy(stored_p, value_p, value_len);
+	stored_p[value_len] = '\0';
+#if K_DBM_VALUE_STORAGE == K_DBM_VALUE_STORAGE_ARENA
+	/* The unused tail goes back to the arena */
+	k_dbm_arena_shrink(&k_dbm_context.db.value_arena, entry_p->value_offset, value_len + 1);
+#endif
+	entry_p->value_len = (uint32_t)value_len;
+}
+
+#if K_DBM_VALUE_STORAGE == K_DBM_VALUE_STORAGE_ARENA
+static void *k_dbm_value_ptr(uint32_t value_offset) { return k_dbm_arena_ptr(&k_dbm_context.db.value_arena, value_offset); }
+
+static uint32_t k_dbm_value_alloc(size_t size) { return k_dbm_arena_alloc(&k_dbm_context.db.value_arena, size); }
+
+static void k_dbm_value_release(uint32_t value_offset) { k_dbm_arena_free(&k_dbm_context.db.value_arena, value_offset); }
+
+static size_t k_dbm_value_capacity(uint32_t value_offset) { return k_dbm_arena_capacity(&k_dbm_context.db.value_arena, value_offset); }
+
+static int k_dbm_value_keeps_block(uint32_t value_offset, size_t size) { return size <= k_dbm_value_capacity(value_offset); }
+#else
+static void *k_dbm_value_ptr(uint32_t value_offset) { return k_dbm_slab_ptr(value_offset); }
+
+static uint32_t k_dbm_value_alloc(size_t size) { return k_dbm_slab_alloc(size); }
+
+static void k_dbm_value_release(uint32_t value_offset) { k_dbm_slab_free(value_offset); }
+
+static size_t k_dbm_value_capacity(uint32_t value_offset) { return k_dbm_slab_capacity(value_offset); }
+
+static int k_dbm_value_keeps_block(uint32_t value_offset, size_t size)
+{
+	/* Only the smallest class that fits keeps the value, otherwise it moves to it */
+	return k_dbm_value_capacity(value_offset) == k_dbm_slab_fit(size);
+}
+#endif
+#endif
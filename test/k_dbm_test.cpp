@@ -3,14 +3,24 @@
 #include <gtest/gtest.h>
 #include <k_dbm_priv.h>
 
+#include <string>
+#include <vector>
+
 #include "k_dbm_priv.h"
 
 size_t insert_in_nvm_count	 = 0;
 size_t get_from_nvm_count	 = 0;
 size_t delete_from_nvm_count = 0;
+size_t delete_prefix_count	 = 0;
 size_t mutex_lock_count		 = 0;
 size_t mutex_unlock_count	 = 0;
 
+std::string last_nvm_value;
+void (*nvm_insert_hook)(const char *key) = nullptr;
+
+static const char nvm_blob[]	= {'b', '\0', 'l', 'o', 'b'};
+static const char nvm_counter[] = {K_DBM_VALUE_RECORD_TAG, K_DBM_VALUE_TYPE_I32, '\x2A', '\xFF', '\xFF', '\xFF'};
+
 int test_mutex_lock(int timeout_ms)
 {
 	mutex_lock_count++;
@@ -20,6 +30,14 @@ void test_mutex_unlock() { mutex_unlock_count++; };
 int	 test_dbm_insert(const char *key, const char *value)
 {
 	insert_in_nvm_count++;
+	last_nvm_value = value;
+	if (nvm_insert_hook)
+	{
+		/* Runs once, like another thread calling k_dbm during the NVM write */
+		void (*hook_f)(const char *key) = nvm_insert_hook;
+		nvm_insert_hook					= nullptr;
+		hook_f(key);
+	}
 	if (0 == strcmp(key, "key_fail"))
 	{
 		return -1;
@@ -29,7 +47,7 @@ int	 test_dbm_insert(const char *key, const char *value)
 int test_dbm_get(const char *key, char *value, size_t value_buffer_size)
 {
 	get_from_nvm_count++;
-	if (0 == strcmp(key, "non_existent_key"))
+	if (0 == strcmp(key, "non_existent_key") || 0 == strncmp(key, "missing", strlen("missing")))
 	{
 		memset(value, 0, value_buffer_size);
 		return -1;
@@ -39,6 +57,24 @@ int test_dbm_get(const char *key, char *value, size_t value_buffer_size)
 		strncpy(value, "nvmValue", value_buffer_size);
 		return 0;
 	}
+	else if (0 == strcmp(key, "nvmDecimal"))
+	{
+		strncpy(value, "41", value_buffer_size);
+		return 0;
+	}
+	else if (0 == strcmp(key, "nvmCounter"))
+	{
+		/* Typed record read back by a string backend */
+		memcpy(value, nvm_counter, sizeof(nvm_counter));
+		value[sizeof(nvm_counter)] = '\0';
+		return 0;
+	}
+	else if (0 == strncmp(key, "stored/", strlen("stored/")))
+	{
+		/* Last value saved, read back cold */
+		strncpy(value, last_nvm_value.c_str(), value_buffer_size);
+		return 0;
+	}
 	return 0;
 }
 int test_dbm_delete(const char *key)
@@ -51,25 +87,106 @@ int test_dbm_delete(const char *key)
 	return 0;
 }
 
+int test_dbm_delete_prefix(const char *prefix)
+{
+	delete_prefix_count++;
+	if (0 == strcmp(prefix, "fail/"))
+	{
+		return -1;
+	}
+	return 0;
+}
+
+size_t		insert_blob_in_nvm_count = 0;
+std::string last_nvm_blob;
+
+int test_dbm_insert_blob(const char *key, const void *data, size_t data_len)
+{
+	insert_blob_in_nvm_count++;
+	last_nvm_blob.assign(static_cast<const char *>(data), data_len);
+	if (0 == strcmp(key, "key_fail"))
+	{
+		return -1;
+	}
+	return 0;
+}
+
+int test_dbm_get_blob(const char *key, void *buffer, size_t buffer_size, size_t *data_len)
+{
+	get_from_nvm_count++;
+	*data_len = 0;
+	if (0 == strcmp(key, "nvmBlob"))
+	{
+		*data_len = sizeof(nvm_blob);
+		if (buffer_size < sizeof(nvm_blob))
+		{
+			return -1;
+		}
+		memcpy(buffer, nvm_blob, sizeof(nvm_blob));
+		return 0;
+	}
+	else if (0 == strcmp(key, "nvmCounter"))
+	{
+		*data_len = sizeof(nvm_counter);
+		memcpy(buffer, nvm_counter, sizeof(nvm_counter));
+		return 0;
+	}
+	else if (0 == strncmp(key, "stored/", strlen("stored/")))
+	{
+		*data_len = last_nvm_blob.size();
+		memcpy(buffer, last_nvm_blob.data(), last_nvm_blob.size());
+		return 0;
+	}
+	return -1;
+}
+
 extern k_dbm_context_t k_dbm_context;
 
+/* Link an entry at a given position, bypassing the free stack */
+static void k_dbm_place_entry(int db_index, const char *key_p, k_dbm_storage_t storage)
+{
+	size_t		   bucket  = 0;
+	size_t		   key_len = 0;
+	const uint32_t hash	   = k_dbm_hash_key(key_p, &key_len);
+	k_dbm_index_lookup(key_p, key_len, hash, &bucket);
+	k_dbm_context.db.entries_a[db_index].key	  = key_p;
+	k_dbm_context.db.entries_a[db_index].key_hash = hash;
+	k_dbm_context.db.entries_a[db_index].key_len  = (uint32_t)key_len;
+	k_dbm_context.db.entries_a[db_index].storage  = storage;
+	k_dbm_index_insert(db_index, bucket);
+	k_dbm_ordered_insert(db_index);
+}
+
+/* Collect the keys reported by k_dbm_scan_prefix, stop after max_keys when it is not 0 */
+struct scan_result_t
+{
+	std::vector<std::string> keys;
+	std::vector<std::string> values;
+	size_t					 max_keys;
+};
+
+static int scan_collect(const char *key_p, const char *value_p, size_t value_len, void *ctx_p)
+{
+	scan_result_t *result_p = static_cast<scan_result_t *>(ctx_p);
+	result_p->keys.emplace_back(key_p);
+	result_p->values.emplace_back(value_p, value_len);
+	return result_p->max_keys && result_p->keys.size() >= result_p->max_keys;
+}
+
 class k_dbmTest : public ::testing::Test
 {
    protected:
 	void SetUp() override
 	{
 		k_dbm_init(&config);
-		insert_in_nvm_count	  = 0;
-		get_from_nvm_count	  = 0;
-		delete_from_nvm_count = 0;
-		mutex_lock_count	  = 0;
-		mutex_unlock_count	  = 0;
-		for (size_t i = 0; i < K_DBM_DB_SIZE; i++)
-		{
-			k_dbm_context.db.entries_a[i].storage  = K_DBM_STORAGE_NONE;
-			k_dbm_context.db.entries_a[i].key	   = nullptr;
-			k_dbm_context.db.entries_a[i].value[0] = '\0';
-		}
+		insert_in_nvm_count		 = 0;
+		get_from_nvm_count		 = 0;
+		delete_from_nvm_count	 = 0;
+		delete_prefix_count		 = 0;
+		insert_blob_in_nvm_count = 0;
+		mutex_lock_count		 = 0;
+		mutex_unlock_count		 = 0;
+		nvm_insert_hook			 = nullptr;
 	}
 
 	const k_dbm_config_t config = {
@@ -123,54 +240,111 @@ TEST(k_dbm, initFailMissingFunction)
 	EXPECT_EQ(k_dbm_init(&config), -1);
 }
 
+TEST(k_dbm, entryHoldsMetadataOnly)
+{
+	/* Values are stored apart from the entries, an entry must fit in half a cache line whatever the value size */
+	EXPECT_LE(sizeof(k_dbm_entry_t), 32);
+}
+
 TEST_F(k_dbmTest, firstFreeEntryIs0) { EXPECT_EQ(k_dbm_find_first_empty_entry(), 0); }
 
 TEST_F(k_dbmTest, firstFreeEntryIs2)
 {
-	k_dbm_context.db.entries_a[0].storage = K_DBM_STORAGE_RAM;
-	k_dbm_context.db.entries_a[1].storage = K_DBM_STORAGE_NVM;
+	EXPECT_EQ(k_dbm_insert("key1", "value1", K_DBM_STORAGE_RAM), 0);
+	EXPECT_EQ(k_dbm_insert("key2", "value2", K_DBM_STORAGE_NVM), 0);
 	EXPECT_EQ(k_dbm_find_first_empty_entry(), 2);
 }
 
 TEST_F(k_dbmTest, firstFreeEntryIsLastOne)
 {
-	for (size_t i = 0; i < K_DBM_DB_SIZE - 1; i++)
+	static char keys[K_DBM_DYNAMIC_DB_SIZE][16];
+	for (size_t i = 0; i < K_DBM_DYNAMIC_DB_SIZE - 1; i++)
 	{
-		k_dbm_context.db.entries_a[i].storage = K_DBM_STORAGE_RAM;
+		snprintf(keys[i], sizeof(keys[i]), "key%zu", i);
+		EXPECT_EQ(k_dbm_insert(keys[i], "value", K_DBM_STORAGE_RAM), 0);
 	}
-	EXPECT_EQ(k_dbm_find_first_empty_entry(), K_DBM_DB_SIZE - 1);
+	EXPECT_EQ(k_dbm_find_first_empty_entry(), K_DBM_DYNAMIC_DB_SIZE - 1);
 }
 
 TEST_F(k_dbmTest, noFreeEntries)
 {
-	for (size_t i = 0; i < K_DBM_DB_SIZE; i++)
+	static char keys[K_DBM_DYNAMIC_DB_SIZE][16];
+	for (size_t i = 0; i < K_DBM_DYNAMIC_DB_SIZE; i++)
 	{
-		k_dbm_context.db.entries_a[i].storage = K_DBM_STORAGE_RAM;
+		snprintf(keys[i], sizeof(keys[i]), "key%zu", i);
+		EXPECT_EQ(k_dbm_insert(keys[i], "value", K_DBM_STORAGE_RAM), 0);
 	}
 	EXPECT_EQ(k_dbm_find_first_empty_entry(), -1);
+	EXPECT_EQ(k_dbm_insert("one_more_key", "value", K_DBM_STORAGE_RAM), -1);
+}
+
+TEST_F(k_dbmTest, freedEntryIsReused)
+{
+	EXPECT_EQ(k_dbm_insert("key1", "value1", K_DBM_STORAGE_RAM), 0);
+	EXPECT_EQ(k_dbm_insert("key2", "value2", K_DBM_STORAGE_RAM), 0);
+	EXPECT_EQ(k_dbm_insert("key3", "value3", K_DBM_STORAGE_RAM), 0);
+	EXPECT_EQ(k_dbm_delete("key2"), 0);
+	EXPECT_EQ(k_dbm_find_first_empty_entry(), 1);
+	EXPECT_EQ(k_dbm_insert("key4", "value4", K_DBM_STORAGE_RAM), 0);
+	EXPECT_EQ(k_dbm_find_entry("key4"), 1);
+	EXPECT_EQ(k_dbm_find_first_empty_entry(), 3);
 }
 
 TEST_F(k_dbmTest, findEntryNotFound) { EXPECT_EQ(k_dbm_find_entry("non_existent_key"), -1); }
 
 TEST_F(k_dbmTest, findEntryFound)
 {
-	k_dbm_context.db.entries_a[0].key	  = "key";
-	k_dbm_context.db.entries_a[0].storage = K_DBM_STORAGE_RAM;
+	k_dbm_place_entry(0, "key", K_DBM_STORAGE_RAM);
 	EXPECT_EQ(k_dbm_find_entry("key"), 0);
 }
 
 TEST_F(k_dbmTest, findEntryFoundInNVM)
 {
-	k_dbm_context.db.entries_a[29].key	   = "nvmKey";
-	k_dbm_context.db.entries_a[29].storage = K_DBM_STORAGE_NVM;
+	k_dbm_place_entry(29, "nvmKey", K_DBM_STORAGE_NVM);
 	EXPECT_EQ(k_dbm_find_entry("nvmKey"), 29);
 }
 
+TEST_F(k_dbmTest, findEntryAfterDeletesInFullDb)
+{
+	static char keys[K_DBM_DYNAMIC_DB_SIZE][16];
+	for (size_t i = 0; i < K_DBM_DYNAMIC_DB_SIZE; i++)
+	{
+		snprintf(keys[i], sizeof(keys[i]), "key%zu", i);
+		EXPECT_EQ(k_dbm_insert(keys[i], "value", K_DBM_STORAGE_RAM), 0);
+	}
+	for (size_t i = 0; i < K_DBM_DYNAMIC_DB_SIZE; i += 2)
+	{
+		EXPECT_EQ(k_dbm_delete(keys[i]), 0);
+	}
+	for (size_t i = 0; i < K_DBM_DYNAMIC_DB_SIZE; i++)
+	{
+		if (i % 2)
+		{
+			EXPECT_EQ(k_dbm_find_entry(keys[i]), (int)i);
+		}
+		else
+		{
+			EXPECT_EQ(k_dbm_find_entry(keys[i]), -1);
+		}
+	}
+}
+
+TEST_F(k_dbmTest, findEntryWithSharedPrefix)
+{
+	char lookup_key[] = "sensor/zone3/probe1";
+	EXPECT_EQ(k_dbm_insert("sensor/zone3/probe1", "value1", K_DBM_STORAGE_RAM), 0);
+	EXPECT_EQ(k_dbm_insert("sensor/zone3/probe10", "value10", K_DBM_STORAGE_RAM), 0);
+	EXPECT_EQ(k_dbm_find_entry(lookup_key), 0);
+	EXPECT_EQ(k_dbm_find_entry("sensor/zone3/probe10"), 1);
+	EXPECT_EQ(k_dbm_find_entry("sensor/zone3/probe"), -1);
+	EXPECT_EQ(k_dbm_context.db.entries_a[1].key_len, strlen("sensor/zone3/probe10"));
+}
+
 TEST_F(k_dbmTest, insertInRamSuccess)
 {
 	EXPECT_EQ(k_dbm_insert("key", "value", K_DBM_STORAGE_RAM), 0);
 	EXPECT_STREQ(k_dbm_context.db.entries_a[0].key, "key");
-	EXPECT_STREQ(k_dbm_context.db.entries_a[0].value, "value");
+	EXPECT_STREQ(k_dbm_value_get(0), "value");
 	EXPECT_EQ(k_dbm_context.db.entries_a[0].storage, K_DBM_STORAGE_RAM);
 	EXPECT_EQ(insert_in_nvm_count, 0);
 }
@@ -179,7 +353,7 @@ TEST_F(k_dbmTest, insertInNVMSuccess)
 {
 	EXPECT_EQ(k_dbm_insert("key", "value", K_DBM_STORAGE_NVM), 0);
 	EXPECT_STREQ(k_dbm_context.db.entries_a[0].key, "key");
-	EXPECT_STREQ(k_dbm_context.db.entries_a[0].value, "value");
+	EXPECT_STREQ(k_dbm_value_get(0), "value");
 	EXPECT_EQ(k_dbm_context.db.entries_a[0].storage, K_DBM_STORAGE_NVM);
 	EXPECT_EQ(insert_in_nvm_count, 1);
 }
@@ -188,7 +362,7 @@ TEST_F(k_dbmTest, insertInNVMFail)
 {
 	EXPECT_EQ(k_dbm_insert("key_fail", "value", K_DBM_STORAGE_NVM), -1);
 	EXPECT_EQ(k_dbm_context.db.entries_a[0].key, nullptr);
-	EXPECT_STREQ(k_dbm_context.db.entries_a[0].value, "");
+	EXPECT_STREQ(k_dbm_value_get(0), "");
 	EXPECT_EQ(k_dbm_context.db.entries_a[0].storage, K_DBM_STORAGE_NONE);
 	EXPECT_EQ(insert_in_nvm_count, 1);
 }
@@ -334,7 +508,7 @@ TEST_F(k_dbmTest, deleteExistingKeyInNVMFail)
 TEST_F(k_dbmTest, getDbEmpty)
 {
 	size_t free_space = k_dbm_get_free_space();
-	EXPECT_EQ(free_space, K_DBM_DB_SIZE);
+	EXPECT_EQ(free_space, K_DBM_DYNAMIC_DB_SIZE);
 }
 
 TEST_F(k_dbmTest, getDbWithEntries)
@@ -343,8 +517,1909 @@ TEST_F(k_dbmTest, getDbWithEntries)
 	EXPECT_EQ(k_dbm_insert("key2", "value2", K_DBM_STORAGE_NVM), 0);
 	EXPECT_EQ(k_dbm_insert("key3", "value3", K_DBM_STORAGE_RAM), 0);
 	size_t free_space = k_dbm_get_free_space();
-	EXPECT_EQ(free_space, K_DBM_DB_SIZE - 3);
+	EXPECT_EQ(free_space, K_DBM_DYNAMIC_DB_SIZE - 3);
+	EXPECT_EQ(k_dbm_context.db.db_count, 3);
 	EXPECT_NE(k_dbm_find_entry("key1"), -1);
 	EXPECT_NE(k_dbm_find_entry("key2"), -1);
 	EXPECT_NE(k_dbm_find_entry("key3"), -1);
-}
\ No newline at end of file
+}
+
+TEST_F(k_dbmTest, getFreeSpaceAfterDelete)
+{
+	EXPECT_EQ(k_dbm_insert("key1", "value1", K_DBM_STORAGE_RAM), 0);
+	EXPECT_EQ(k_dbm_insert("key2", "value2", K_DBM_STORAGE_RAM), 0);
+	EXPECT_EQ(k_dbm_insert("key1", "new_value1", K_DBM_STORAGE_RAM), 0);
+	EXPECT_EQ(k_dbm_get_free_space(), K_DBM_DYNAMIC_DB_SIZE - 2);
+	EXPECT_EQ(k_dbm_delete("key1"), 0);
+	EXPECT_EQ(k_dbm_get_free_space(), K_DBM_DYNAMIC_DB_SIZE - 1);
+	EXPECT_EQ(k_dbm_context.db.db_count, 1);
+	EXPECT_EQ(mutex_lock_count, mutex_unlock_count);
+}
+
+TEST_F(k_dbmTest, scanPrefixReportsSubtreeInOrder)
+{
+	scan_result_t result = {};
+	EXPECT_EQ(k_dbm_insert("net/eth0/mask", "255.0.0.0", K_DBM_STORAGE_RAM), 0);
+	EXPECT_EQ(k_dbm_insert("net/eth1/ip", "10.0.1.1", K_DBM_STORAGE_RAM), 0);
+	EXPECT_EQ(k_dbm_insert("net/eth0/ip", "10.0.0.1", K_DBM_STORAGE_NVM), 0);
+	EXPECT_EQ(k_dbm_insert("net/eth0", "up", K_DBM_STORAGE_RAM), 0);
+	EXPECT_EQ(k_dbm_insert("net", "root", K_DBM_STORAGE_RAM), 0);
+	EXPECT_EQ(k_dbm_insert("sensor/zone3", "21", K_DBM_STORAGE_RAM), 0);
+	EXPECT_EQ(k_dbm_scan_prefix("net/eth0/", scan_collect, &result), 0);
+	EXPECT_EQ(result.keys, std::vector<std::string>({"net/eth0/ip", "net/eth0/mask"}));
+	EXPECT_EQ(result.values, std::vector<std::string>({"10.0.0.1", "255.0.0.0"}));
+	EXPECT_EQ(mutex_lock_count, 7);
+	EXPECT_EQ(mutex_unlock_count, 7);
+	EXPECT_EQ(get_from_nvm_count, 0);
+}
+
+TEST_F(k_dbmTest, scanPrefixStopsWhenCallbackAsks)
+{
+	scan_result_t result = {};
+	result.max_keys		 = 2;
+	EXPECT_EQ(k_dbm_insert("a/3", "3", K_DBM_STORAGE_RAM), 0);
+	EXPECT_EQ(k_dbm_insert("a/1", "1", K_DBM_STORAGE_RAM), 0);
+	EXPECT_EQ(k_dbm_insert("a/2", "2", K_DBM_STORAGE_RAM), 0);
+	EXPECT_EQ(k_dbm_delete("a/1"), 0);
+	EXPECT_EQ(k_dbm_insert("a/4", "4", K_DBM_STORAGE_RAM), 0);
+	EXPECT_EQ(k_dbm_scan_prefix("", scan_collect, &result), 0);
+	EXPECT_EQ(result.keys, std::vector<std::string>({"a/2", "a/3"}));
+}
+
+TEST_F(k_dbmTest, scanPrefixWithoutMatches)
+{
+	scan_result_t result = {};
+	EXPECT_EQ(k_dbm_insert("a", "1", K_DBM_STORAGE_RAM), 0);
+	EXPECT_EQ(k_dbm_scan_prefix("b", scan_collect, &result), 0);
+	EXPECT_EQ(k_dbm_scan_prefix("ab", scan_collect, &result), 0);
+	EXPECT_TRUE(result.keys.empty());
+	EXPECT_EQ(k_dbm_scan_prefix(nullptr, scan_collect, &result), -1);
+	EXPECT_EQ(k_dbm_scan_prefix("a", nullptr, &result), -1);
+}
+
+TEST_F(k_dbmTest, deletePrefixWithPerKeyNVMDelete)
+{
+	EXPECT_EQ(k_dbm_insert("key_delete_fail", "value", K_DBM_STORAGE_NVM), 0);
+	EXPECT_EQ(k_dbm_insert("key_nvm", "value", K_DBM_STORAGE_NVM), 0);
+	EXPECT_EQ(k_dbm_insert("key_ram", "value", K_DBM_STORAGE_RAM), 0);
+	EXPECT_EQ(k_dbm_insert("other", "value", K_DBM_STORAGE_RAM), 0);
+	EXPECT_EQ(k_dbm_delete_prefix("key_"), -1);
+	EXPECT_EQ(delete_from_nvm_count, 2);
+	EXPECT_EQ(mutex_lock_count, 5);
+	EXPECT_EQ(mutex_unlock_count, 5);
+	EXPECT_NE(k_dbm_find_entry("key_delete_fail"), -1);
+	EXPECT_EQ(k_dbm_find_entry("key_nvm"), -1);
+	EXPECT_EQ(k_dbm_find_entry("key_ram"), -1);
+	EXPECT_NE(k_dbm_find_entry("other"), -1);
+	EXPECT_EQ(k_dbm_get_free_space(), K_DBM_DYNAMIC_DB_SIZE - 2);
+}
+
+TEST_F(k_dbmTest, deletePrefixWithoutEnumerationIsPartial)
+{
+	EXPECT_EQ(k_dbm_insert("app/a", "value", K_DBM_STORAGE_NVM), 0);
+	EXPECT_EQ(k_dbm_insert("app/b", "value", K_DBM_STORAGE_RAM), 0);
+	EXPECT_EQ(k_dbm_delete_prefix("app/"), -2);
+	EXPECT_EQ(delete_from_nvm_count, 1);
+	EXPECT_EQ(k_dbm_find_entry("app/a"), -1);
+	EXPECT_EQ(k_dbm_find_entry("app/b"), -1);
+}
+
+/* Keys stored in NVM but never cached */
+static int test_dbm_enumerate_uncached(k_dbm_enumerate_cb_t callback_f, void *ctx_p)
+{
+	callback_f("app/uncached", ctx_p);
+	callback_f("apple", ctx_p);
+	callback_f("key_delete_fail", ctx_p);
+	return 0;
+}
+
+TEST_F(k_dbmTest, deletePrefixDeletesUncachedNVMKeys)
+{
+	k_dbm_config_t enumerate_config	   = config;
+	enumerate_config.k_dbm_enumerate_f = test_dbm_enumerate_uncached;
+	EXPECT_EQ(k_dbm_init(&enumerate_config), 0);
+	EXPECT_EQ(k_dbm_insert("app/cached", "value", K_DBM_STORAGE_NVM), 0);
+	EXPECT_EQ(k_dbm_delete_prefix("app/"), 0);
+	/* The cached key, then the uncached one, apple is left alone */
+	EXPECT_EQ(delete_from_nvm_count, 2);
+	EXPECT_EQ(k_dbm_find_entry("app/cached"), -1);
+
+	EXPECT_EQ(k_dbm_delete_prefix("key_"), -1);
+	EXPECT_EQ(delete_from_nvm_count, 3);
+	EXPECT_EQ(mutex_lock_count, mutex_unlock_count);
+}
+
+TEST_F(k_dbmTest, deletePrefixWithBatchedNVMDelete)
+{
+	k_dbm_config_t batched_config		 = config;
+	batched_config.k_dbm_delete_prefix_f = test_dbm_delete_prefix;
+	EXPECT_EQ(k_dbm_init(&batched_config), 0);
+	EXPECT_EQ(k_dbm_insert("app/a", "value", K_DBM_STORAGE_NVM), 0);
+	EXPECT_EQ(k_dbm_insert("app/b", "value", K_DBM_STORAGE_NVM), 0);
+	EXPECT_EQ(k_dbm_insert("app/c", "value", K_DBM_STORAGE_RAM), 0);
+	EXPECT_EQ(k_dbm_insert("apple", "value", K_DBM_STORAGE_NVM), 0);
+	EXPECT_EQ(k_dbm_delete_prefix("app/"), 0);
+	EXPECT_EQ(delete_prefix_count, 1);
+	EXPECT_EQ(delete_from_nvm_count, 0);
+	EXPECT_EQ(k_dbm_find_entry("app/a"), -1);
+	EXPECT_EQ(k_dbm_find_entry("app/b"), -1);
+	EXPECT_EQ(k_dbm_find_entry("app/c"), -1);
+	EXPECT_NE(k_dbm_find_entry("apple"), -1);
+}
+
+TEST_F(k_dbmTest, deletePrefixBatchedFailureKeepsEntries)
+{
+	k_dbm_config_t batched_config		 = config;
+	batched_config.k_dbm_delete_prefix_f = test_dbm_delete_prefix;
+	EXPECT_EQ(k_dbm_init(&batched_config), 0);
+	EXPECT_EQ(k_dbm_insert("fail/a", "value", K_DBM_STORAGE_NVM), 0);
+	EXPECT_EQ(k_dbm_insert("fail/b", "value", K_DBM_STORAGE_RAM), 0);
+	EXPECT_EQ(k_dbm_delete_prefix("fail/"), -1);
+	EXPECT_EQ(delete_prefix_count, 1);
+	EXPECT_NE(k_dbm_find_entry("fail/a"), -1);
+	EXPECT_NE(k_dbm_find_entry("fail/b"), -1);
+	EXPECT_EQ(k_dbm_delete_prefix(nullptr), -1);
+}
+
+TEST_F(k_dbmTest, unknownKeyIdIsRejected)
+{
+	char value_buffer[32] = {0};
+	EXPECT_EQ(k_dbm_insert_by_id(K_DBM_STATIC_KEY_COUNT, "value", K_DBM_STORAGE_RAM), -1);
+	EXPECT_EQ(k_dbm_get_by_id(K_DBM_STATIC_KEY_COUNT, value_buffer, sizeof(value_buffer)), -1);
+	EXPECT_EQ(mutex_lock_count, 0);
+}
+
+TEST_F(k_dbmTest, blobKeepsEmbeddedNulBytes)
+{
+	const char blob[]		= {'\x01', '\0', '\x02', '\0'};
+	char	   buffer[16]	= {0};
+	size_t	   data_len		= 0;
+	EXPECT_EQ(k_dbm_insert_blob("blob", blob, sizeof(blob), K_DBM_STORAGE_RAM), 0);
+	EXPECT_EQ(k_dbm_get_blob("blob", buffer, sizeof(buffer), &data_len), 0);
+	EXPECT_EQ(data_len, sizeof(blob));
+	EXPECT_EQ(memcmp(buffer, blob, sizeof(blob)), 0);
+	EXPECT_EQ(k_dbm_value_length(k_dbm_find_entry("blob")), sizeof(blob));
+	EXPECT_EQ(insert_in_nvm_count, 0);
+	EXPECT_EQ(insert_blob_in_nvm_count, 0);
+}
+
+TEST_F(k_dbmTest, blobIsNotReadAsString)
+{
+	const char blob[]			= {'a', 'b', 'c'};
+	char	   value_buffer[32] = {0};
+	EXPECT_EQ(k_dbm_insert_blob("blob", blob, sizeof(blob), K_DBM_STORAGE_RAM), 0);
+	EXPECT_EQ(k_dbm_get("blob", value_buffer, sizeof(value_buffer)), -1);
+	EXPECT_EQ(get_from_nvm_count, 0);
+	/* A string overwrite makes the value readable as a string again */
+	EXPECT_EQ(k_dbm_insert("blob", "abc", K_DBM_STORAGE_RAM), 0);
+	EXPECT_EQ(k_dbm_get("blob", value_buffer, sizeof(value_buffer)), 0);
+	EXPECT_STREQ(value_buffer, "abc");
+}
+
+TEST_F(k_dbmTest, stringIsReadAsBlobWithoutTerminator)
+{
+	char   buffer[3] = {0};
+	size_t data_len	 = 0;
+	EXPECT_EQ(k_dbm_insert("key", "abc", K_DBM_STORAGE_RAM), 0);
+	EXPECT_EQ(k_dbm_get_blob("key", buffer, sizeof(buffer), &data_len), 0);
+	EXPECT_EQ(data_len, 3);
+	EXPECT_EQ(memcmp(buffer, "abc", 3), 0);
+}
+
+TEST_F(k_dbmTest, blobTooLargeForBufferReportsLength)
+{
+	const char blob[]	 = {'a', 'b', 'c', 'd'};
+	char	   buffer[2] = {0};
+	size_t	   data_len	 = 0;
+	EXPECT_EQ(k_dbm_insert_blob("blob", blob, sizeof(blob), K_DBM_STORAGE_RAM), 0);
+	EXPECT_EQ(k_dbm_get_blob("blob", buffer, sizeof(buffer), &data_len), -1);
+	EXPECT_EQ(data_len, sizeof(blob));
+}
+
+TEST_F(k_dbmTest, blobInvalidArguments)
+{
+	char   buffer[8] = {0};
+	size_t data_len	 = 0;
+	EXPECT_EQ(k_dbm_insert_blob(nullptr, buffer, 1, K_DBM_STORAGE_RAM), -1);
+	EXPECT_EQ(k_dbm_insert_blob("blob", nullptr, 1, K_DBM_STORAGE_RAM), -1);
+	EXPECT_EQ(k_dbm_insert_blob("blob", buffer, K_DBM_VALUE_MAX_LENGTH, K_DBM_STORAGE_RAM), -1);
+	EXPECT_EQ(k_dbm_insert_blob("blob", buffer, 1, K_DBM_STORAGE_NONE), -1);
+	EXPECT_EQ(k_dbm_get_blob(nullptr, buffer, sizeof(buffer), &data_len), -1);
+	EXPECT_EQ(k_dbm_get_blob("blob", nullptr, sizeof(buffer), &data_len), -1);
+	EXPECT_EQ(k_dbm_get_blob("blob", buffer, sizeof(buffer), nullptr), -1);
+	EXPECT_EQ(mutex_lock_count, 0);
+	EXPECT_EQ(k_dbm_insert_blob("empty", nullptr, 0, K_DBM_STORAGE_RAM), 0);
+	EXPECT_EQ(k_dbm_get_blob("empty", buffer, sizeof(buffer), &data_len), 0);
+	EXPECT_EQ(data_len, 0);
+}
+
+TEST_F(k_dbmTest, blobInNVMNeedsBlobCallbacks)
+{
+	const char blob[] = {'a', '\0', 'b'};
+	EXPECT_EQ(k_dbm_insert_blob("blob", blob, sizeof(blob), K_DBM_STORAGE_NVM), -1);
+	EXPECT_EQ(k_dbm_find_entry("blob"), -1);
+	EXPECT_EQ(insert_in_nvm_count, 0);
+}
+
+TEST_F(k_dbmTest, blobInNVMUsesBlobCallbacks)
+{
+	k_dbm_config_t blob_config		= config;
+	blob_config.k_dbm_insert_blob_f = test_dbm_insert_blob;
+	blob_config.k_dbm_get_blob_f	= test_dbm_get_blob;
+	const char blob[]				= {'a', '\0', 'b'};
+	char	   buffer[16]			= {0};
+	size_t	   data_len				= 0;
+	EXPECT_EQ(k_dbm_init(&blob_config), 0);
+	EXPECT_EQ(k_dbm_insert_blob("blob", blob, sizeof(blob), K_DBM_STORAGE_NVM), 0);
+	EXPECT_EQ(insert_blob_in_nvm_count, 1);
+	EXPECT_EQ(insert_in_nvm_count, 0);
+	EXPECT_EQ(k_dbm_insert_blob("key_fail", blob, sizeof(blob), K_DBM_STORAGE_NVM), -1);
+	EXPECT_EQ(k_dbm_find_entry("key_fail"), -1);
+
+	/* Too small buffer, the length is reported and the value is cached all the same */
+	EXPECT_EQ(k_dbm_get_blob("nvmBlob", buffer, 2, &data_len), -1);
+	EXPECT_EQ(data_len, sizeof(nvm_blob));
+	EXPECT_EQ(k_dbm_get_blob("nvmBlob", buffer, sizeof(buffer), &data_len), 0);
+	EXPECT_EQ(data_len, sizeof(nvm_blob));
+	EXPECT_EQ(memcmp(buffer, nvm_blob, sizeof(nvm_blob)), 0);
+	EXPECT_EQ(get_from_nvm_count, 1);
+	EXPECT_EQ(k_dbm_get("nvmBlob", buffer, sizeof(buffer)), -1);
+}
+
+TEST_F(k_dbmTest, blobReadOfStringInNVMWithoutBlobCallback)
+{
+	char   buffer[16] = {0};
+	size_t data_len	  = 0;
+	EXPECT_EQ(k_dbm_get_blob("nvmKey", buffer, sizeof(buffer), &data_len), 0);
+	EXPECT_EQ(data_len, strlen("nvmValue"));
+	EXPECT_EQ(memcmp(buffer, "nvmValue", data_len), 0);
+	EXPECT_EQ(k_dbm_get("nvmKey", buffer, sizeof(buffer)), 0);
+	EXPECT_STREQ(buffer, "nvmValue");
+	EXPECT_EQ(get_from_nvm_count, 1);
+}
+
+TEST_F(k_dbmTest, typedValuesRoundTrip)
+{
+	int32_t	 i32_value	= 0;
+	uint64_t u64_value	= 0;
+	float	 f32_value	= 0;
+	bool	 bool_value = false;
+	EXPECT_EQ(k_dbm_set_i32("i32", -123456, K_DBM_STORAGE_RAM), 0);
+	EXPECT_EQ(k_dbm_set_u64("u64", UINT64_MAX, K_DBM_STORAGE_RAM), 0);
+	EXPECT_EQ(k_dbm_set_f32("f32", 21.5f, K_DBM_STORAGE_RAM), 0);
+	EXPECT_EQ(k_dbm_set_bool("bool", true, K_DBM_STORAGE_RAM), 0);
+	EXPECT_EQ(k_dbm_get_i32("i32", &i32_value), 0);
+	EXPECT_EQ(i32_value, -123456);
+	EXPECT_EQ(k_dbm_get_u64("u64", &u64_value), 0);
+	EXPECT_EQ(u64_value, UINT64_MAX);
+	EXPECT_EQ(k_dbm_get_f32("f32", &f32_value), 0);
+	EXPECT_EQ(f32_value, 21.5f);
+	EXPECT_EQ(k_dbm_get_bool("bool", &bool_value), 0);
+	EXPECT_TRUE(bool_value);
+	EXPECT_EQ(k_dbm_value_length(k_dbm_find_entry("i32")), sizeof(int32_t));
+	EXPECT_EQ(k_dbm_value_length(k_dbm_find_entry("u64")), sizeof(uint64_t));
+	EXPECT_EQ(get_from_nvm_count, 0);
+
+	EXPECT_EQ(k_dbm_set_i32("i32", 7, K_DBM_STORAGE_RAM), 0);
+	EXPECT_EQ(k_dbm_get_i32("i32", &i32_value), 0);
+	EXPECT_EQ(i32_value, 7);
+}
+
+TEST_F(k_dbmTest, typedValueTypeMustMatch)
+{
+	int32_t	 i32_value = 0;
+	uint64_t u64_value = 0;
+	EXPECT_EQ(k_dbm_set_i32("counter", 5, K_DBM_STORAGE_RAM), 0);
+	EXPECT_EQ(k_dbm_insert("string", "5", K_DBM_STORAGE_RAM), 0);
+	EXPECT_EQ(k_dbm_get_u64("counter", &u64_value), -1);
+	EXPECT_EQ(k_dbm_get_i32("string", &i32_value), -1);
+	EXPECT_EQ(k_dbm_get_i32(nullptr, &i32_value), -1);
+	EXPECT_EQ(k_dbm_get_i32("counter", nullptr), -1);
+	EXPECT_EQ(k_dbm_get_bool("counter", nullptr), -1);
+	EXPECT_EQ(k_dbm_set_i32(nullptr, 5, K_DBM_STORAGE_RAM), -1);
+	EXPECT_EQ(k_dbm_set_i32("counter", 5, K_DBM_STORAGE_NONE), -1);
+}
+
+TEST_F(k_dbmTest, typedValueIsFormattedByGet)
+{
+	char value_buffer[32] = {0};
+	EXPECT_EQ(k_dbm_set_i32("i32", -42, K_DBM_STORAGE_RAM), 0);
+	EXPECT_EQ(k_dbm_get("i32", value_buffer, sizeof(value_buffer)), 0);
+	EXPECT_STREQ(value_buffer, "-42");
+	EXPECT_EQ(k_dbm_set_u64("u64", 18446744073709551615ULL, K_DBM_STORAGE_RAM), 0);
+	EXPECT_EQ(k_dbm_get("u64", value_buffer, sizeof(value_buffer)), 0);
+	EXPECT_STREQ(value_buffer, "18446744073709551615");
+	EXPECT_EQ(k_dbm_set_f32("f32", 0.5f, K_DBM_STORAGE_RAM), 0);
+	EXPECT_EQ(k_dbm_get("f32", value_buffer, sizeof(value_buffer)), 0);
+	EXPECT_STREQ(value_buffer, "0.5");
+	EXPECT_EQ(k_dbm_set_bool("bool", false, K_DBM_STORAGE_RAM), 0);
+	EXPECT_EQ(k_dbm_get("bool", value_buffer, sizeof(value_buffer)), 0);
+	EXPECT_STREQ(value_buffer, "0");
+	EXPECT_EQ(k_dbm_get("i32", value_buffer, 3), -1);
+}
+
+TEST_F(k_dbmTest, typedValueInNVMNeedsBlobCallbacks)
+{
+	int32_t i32_value = 0;
+	EXPECT_EQ(k_dbm_set_i32("counter", 5, K_DBM_STORAGE_NVM), -1);
+	EXPECT_EQ(k_dbm_find_entry("counter"), -1);
+	EXPECT_EQ(k_dbm_get_i32("nvmCounter", &i32_value), -1);
+	EXPECT_EQ(insert_in_nvm_count, 0);
+	EXPECT_EQ(get_from_nvm_count, 0);
+}
+
+TEST_F(k_dbmTest, typedValueInNVMUsesCompactRecord)
+{
+	k_dbm_config_t blob_config		= config;
+	blob_config.k_dbm_insert_blob_f = test_dbm_insert_blob;
+	blob_config.k_dbm_get_blob_f	= test_dbm_get_blob;
+	int32_t		i32_value			= 0;
+	uint64_t	u64_value			= 0;
+	EXPECT_EQ(k_dbm_init(&blob_config), 0);
+	EXPECT_EQ(k_dbm_set_i32("counter", 0x01020304, K_DBM_STORAGE_NVM), 0);
+	EXPECT_EQ(last_nvm_blob, std::string("\x00\x02\x04\x03\x02\x01", 6));
+	EXPECT_EQ(k_dbm_set_u64("big", 0x0102030405060708ULL, K_DBM_STORAGE_NVM), 0);
+	EXPECT_EQ(last_nvm_blob, std::string("\x00\x03\x08\x07\x06\x05\x04\x03\x02\x01", 10));
+	EXPECT_EQ(k_dbm_set_bool("flag", true, K_DBM_STORAGE_NVM), 0);
+	EXPECT_EQ(last_nvm_blob, std::string("\x00\x05\x01", 3));
+	EXPECT_EQ(insert_blob_in_nvm_count, 3);
+	EXPECT_EQ(insert_in_nvm_count, 0);
+
+	/* The record type is checked, the value is still cached in native form */
+	EXPECT_EQ(k_dbm_get_u64("nvmCounter", &u64_value), -1);
+	EXPECT_EQ(get_from_nvm_count, 1);
+	EXPECT_EQ(k_dbm_get_i32("nvmCounter", &i32_value), 0);
+	EXPECT_EQ(i32_value, -214);
+	EXPECT_EQ(get_from_nvm_count, 1);
+}
+
+TEST_F(k_dbmTest, typedValueInNVMReadAsBlob)
+{
+	k_dbm_config_t blob_config	 = config;
+	blob_config.k_dbm_get_blob_f = test_dbm_get_blob;
+	int32_t i32_value			 = 0;
+	int32_t data[2]				 = {0};
+	size_t	data_len			 = 0;
+	int64_t new_value			 = 0;
+	EXPECT_EQ(k_dbm_init(&blob_config), 0);
+
+	/* Same bytes cold and cached, the native value without the record type */
+	EXPECT_EQ(k_dbm_get_blob("nvmCounter", data, sizeof(data), &data_len), 0);
+	EXPECT_EQ(data_len, sizeof(int32_t));
+	EXPECT_EQ(data[0], -214);
+	EXPECT_EQ(k_dbm_get_blob("nvmCounter", data, sizeof(data), &data_len), 0);
+	EXPECT_EQ(data_len, sizeof(int32_t));
+	EXPECT_EQ(data[0], -214);
+	EXPECT_EQ(k_dbm_get_i32("nvmCounter", &i32_value), 0);
+	EXPECT_EQ(i32_value, -214);
+	EXPECT_EQ(k_dbm_increment("nvmCounter", 14, &new_value, true), 0);
+	EXPECT_EQ(new_value, -200);
+	EXPECT_EQ(get_from_nvm_count, 1);
+
+	/* A blob that is not a record stays a blob */
+	EXPECT_EQ(k_dbm_get_i32("nvmBlob", &i32_value), -1);
+	EXPECT_EQ(k_dbm_get_blob("nvmBlob", data, sizeof(data), &data_len), 0);
+	EXPECT_EQ(data_len, sizeof(nvm_blob));
+	EXPECT_EQ(get_from_nvm_count, 2);
+}
+
+TEST_F(k_dbmTest, typedValueInNVMReadAsString)
+{
+	k_dbm_config_t blob_config	 = config;
+	blob_config.k_dbm_get_blob_f = test_dbm_get_blob;
+	char	value_buffer[32]	 = {0};
+	int32_t i32_value			 = 0;
+	EXPECT_EQ(k_dbm_init(&blob_config), 0);
+
+	/* Formatted cold and cached, the empty string read is read again as a record */
+	EXPECT_EQ(k_dbm_get("nvmCounter", value_buffer, sizeof(value_buffer)), 0);
+	EXPECT_STREQ(value_buffer, "-214");
+	EXPECT_EQ(get_from_nvm_count, 2);
+	EXPECT_EQ(k_dbm_get("nvmCounter", value_buffer, sizeof(value_buffer)), 0);
+	EXPECT_STREQ(value_buffer, "-214");
+	EXPECT_EQ(k_dbm_get_i32("nvmCounter", &i32_value), 0);
+	EXPECT_EQ(i32_value, -214);
+	EXPECT_EQ(get_from_nvm_count, 2);
+
+	/* Plain strings only take one read */
+	EXPECT_EQ(k_dbm_get("nvmKey", value_buffer, sizeof(value_buffer)), 0);
+	EXPECT_STREQ(value_buffer, "nvmValue");
+	EXPECT_EQ(get_from_nvm_count, 3);
+}
+
+TEST_F(k_dbmTest, untypedValuesInNVMAreNeverDecoded)
+{
+	k_dbm_config_t blob_config		= config;
+	blob_config.k_dbm_insert_blob_f = test_dbm_insert_blob;
+	blob_config.k_dbm_get_blob_f	= test_dbm_get_blob;
+	const char	   type_first[]		= {K_DBM_VALUE_TYPE_I32, '\x01', '\x02', '\x03', '\x04'};
+	const char	   tag_first[]		= {K_DBM_VALUE_RECORD_TAG, K_DBM_VALUE_TYPE_I32, '\x01', '\x02', '\x03', '\x04'};
+	char		   buffer[16]		= {0};
+	size_t		   data_len			= 0;
+	EXPECT_EQ(k_dbm_init(&blob_config), 0);
+
+	/* Saved, dropped from the cache, then read back cold */
+	EXPECT_EQ(k_dbm_insert_blob("stored/blob", type_first, sizeof(type_first), K_DBM_STORAGE_NVM), 0);
+	k_dbm_free_entry(k_dbm_find_entry("stored/blob"));
+	EXPECT_EQ(k_dbm_get_blob("stored/blob", buffer, sizeof(buffer), &data_len), 0);
+	EXPECT_EQ(std::string(buffer, data_len), std::string(type_first, sizeof(type_first)));
+
+	/* A blob starting with the record tag is saved with a second one */
+	EXPECT_EQ(k_dbm_insert_blob("stored/tagged", tag_first, sizeof(tag_first), K_DBM_STORAGE_NVM), 0);
+	EXPECT_EQ(last_nvm_blob, std::string(1, K_DBM_VALUE_RECORD_TAG) + std::string(tag_first, sizeof(tag_first)));
+	k_dbm_free_entry(k_dbm_find_entry("stored/tagged"));
+	EXPECT_EQ(k_dbm_get_blob("stored/tagged", buffer, sizeof(buffer), &data_len), 0);
+	EXPECT_EQ(std::string(buffer, data_len), std::string(tag_first, sizeof(tag_first)));
+
+	EXPECT_EQ(k_dbm_insert("stored/string", "\x05" "A", K_DBM_STORAGE_NVM), 0);
+	k_dbm_free_entry(k_dbm_find_entry("stored/string"));
+	EXPECT_EQ(k_dbm_get("stored/string", buffer, sizeof(buffer)), 0);
+	EXPECT_STREQ(buffer, "\x05" "A");
+}
+
+TEST_F(k_dbmTest, statsCountCacheHitsAndMisses)
+{
+	char		  value_buffer[32] = {0};
+	k_dbm_stats_t stats			   = {};
+	EXPECT_EQ(k_dbm_insert("key", "value", K_DBM_STORAGE_RAM), 0);
+	EXPECT_EQ(k_dbm_get("key", value_buffer, sizeof(value_buffer)), 0);
+	EXPECT_EQ(k_dbm_get("nvmKey", value_buffer, sizeof(value_buffer)), 0);
+	EXPECT_EQ(k_dbm_get("nvmKey", value_buffer, sizeof(value_buffer)), 0);
+	EXPECT_EQ(k_dbm_get("non_existent_key", value_buffer, sizeof(value_buffer)), -1);
+	EXPECT_EQ(k_dbm_get_stats(&stats), 0);
+	EXPECT_EQ(stats.cache_hits, 2);
+	EXPECT_EQ(stats.cache_misses, 2);
+	EXPECT_EQ(k_dbm_get_stats(nullptr), -1);
+
+	/* Reset by init */
+	EXPECT_EQ(k_dbm_init(&config), 0);
+	EXPECT_EQ(k_dbm_get_stats(&stats), 0);
+	EXPECT_EQ(stats.cache_hits, 0);
+	EXPECT_EQ(stats.cache_misses, 0);
+}
+
+TEST_F(k_dbmTest, incrementUpdatesValueInPlace)
+{
+	int64_t	 new_value = 0;
+	int32_t	 i32_value = 0;
+	uint64_t u64_value = 0;
+	EXPECT_EQ(k_dbm_set_i32("i32", 10, K_DBM_STORAGE_RAM), 0);
+	EXPECT_EQ(k_dbm_increment("i32", 5, &new_value, false), 0);
+	EXPECT_EQ(new_value, 15);
+	EXPECT_EQ(k_dbm_increment("i32", -20, nullptr, false), 0);
+	EXPECT_EQ(k_dbm_get_i32("i32", &i32_value), 0);
+	EXPECT_EQ(i32_value, -5);
+	EXPECT_EQ(k_dbm_set_u64("u64", 1, K_DBM_STORAGE_RAM), 0);
+	EXPECT_EQ(k_dbm_increment("u64", 41, &new_value, false), 0);
+	EXPECT_EQ(new_value, 42);
+	EXPECT_EQ(k_dbm_get_u64("u64", &u64_value), 0);
+	EXPECT_EQ(u64_value, 42);
+	EXPECT_EQ(mutex_lock_count, 7);
+	EXPECT_EQ(get_from_nvm_count, 0);
+}
+
+TEST_F(k_dbmTest, incrementRejectsOutOfRangeResult)
+{
+	int64_t	 new_value = 0;
+	int32_t	 i32_value = 0;
+	uint64_t u64_value = 0;
+	EXPECT_EQ(k_dbm_set_i32("i32", INT32_MAX, K_DBM_STORAGE_RAM), 0);
+	EXPECT_EQ(k_dbm_increment("i32", 1, &new_value, false), -1);
+	EXPECT_EQ(k_dbm_increment("i32", INT64_MIN, &new_value, false), -1);
+	EXPECT_EQ(k_dbm_get_i32("i32", &i32_value), 0);
+	EXPECT_EQ(i32_value, INT32_MAX);
+	EXPECT_EQ(k_dbm_set_u64("u64", 1, K_DBM_STORAGE_RAM), 0);
+	EXPECT_EQ(k_dbm_increment("u64", -2, &new_value, false), -1);
+	EXPECT_EQ(k_dbm_increment("u64", INT64_MIN, &new_value, false), -1);
+	EXPECT_EQ(k_dbm_increment("u64", -1, &new_value, false), 0);
+	EXPECT_EQ(new_value, 0);
+	EXPECT_EQ(k_dbm_set_u64("u64", UINT64_MAX - 1, K_DBM_STORAGE_RAM), 0);
+	EXPECT_EQ(k_dbm_increment("u64", 2, &new_value, false), -1);
+	EXPECT_EQ(k_dbm_increment("u64", 1, &new_value, false), 0);
+	EXPECT_EQ(new_value, INT64_MAX);
+	EXPECT_EQ(k_dbm_get_u64("u64", &u64_value), 0);
+	EXPECT_EQ(u64_value, UINT64_MAX);
+}
+
+TEST_F(k_dbmTest, incrementNeedsIntegerValue)
+{
+	EXPECT_EQ(k_dbm_insert("string", "5 apples", K_DBM_STORAGE_RAM), 0);
+	EXPECT_EQ(k_dbm_insert("empty", "", K_DBM_STORAGE_RAM), 0);
+	EXPECT_EQ(k_dbm_set_f32("f32", 1.0f, K_DBM_STORAGE_RAM), 0);
+	EXPECT_EQ(k_dbm_increment("string", 1, nullptr, false), -1);
+	EXPECT_EQ(k_dbm_increment("empty", 1, nullptr, false), -1);
+	EXPECT_EQ(k_dbm_increment("f32", 1, nullptr, false), -1);
+	EXPECT_EQ(k_dbm_increment(nullptr, 1, nullptr, false), -1);
+}
+
+TEST_F(k_dbmTest, incrementUpdatesDecimalString)
+{
+	char	value_buffer[32] = {0};
+	int64_t new_value		 = 0;
+	EXPECT_EQ(k_dbm_insert("string", "9", K_DBM_STORAGE_RAM), 0);
+	EXPECT_EQ(k_dbm_increment("string", 1, &new_value, false), 0);
+	EXPECT_EQ(new_value, 10);
+	EXPECT_EQ(k_dbm_get("string", value_buffer, sizeof(value_buffer)), 0);
+	EXPECT_STREQ(value_buffer, "10");
+	EXPECT_EQ(k_dbm_increment("string", -20, &new_value, false), 0);
+	EXPECT_EQ(new_value, -10);
+
+	/* Saved as a string like k_dbm_insert did */
+	EXPECT_EQ(k_dbm_insert("nvm_string", "-9223372036854775807", K_DBM_STORAGE_NVM), 0);
+	EXPECT_EQ(k_dbm_increment("nvm_string", -1, &new_value, false), 0);
+	EXPECT_EQ(new_value, INT64_MIN);
+	EXPECT_EQ(last_nvm_value, "-9223372036854775808");
+	EXPECT_EQ(k_dbm_increment("nvm_string", -1, &new_value, false), -1);
+	EXPECT_EQ(insert_in_nvm_count, 2);
+}
+
+TEST_F(k_dbmTest, incrementLoadsNVMDecimalString)
+{
+	int64_t new_value = 0;
+	EXPECT_EQ(k_dbm_increment("nvmDecimal", 1, &new_value, false), 0);
+	EXPECT_EQ(new_value, 42);
+	EXPECT_EQ(last_nvm_value, "42");
+	EXPECT_EQ(k_dbm_increment("nvmKey", 1, &new_value, false), -1);
+	EXPECT_EQ(get_from_nvm_count, 2);
+}
+
+TEST_F(k_dbmTest, incrementNeedsExistingKey)
+{
+	int64_t new_value = 7;
+	/* Not found in NVM, or not readable, the key is left for the next read to load */
+	EXPECT_EQ(k_dbm_increment("missing/counter", 1, &new_value, false), -1);
+	EXPECT_EQ(new_value, 7);
+	EXPECT_EQ(k_dbm_find_entry("missing/counter"), -1);
+	EXPECT_EQ(k_dbm_increment("missing/counter", 1, &new_value, true), -1);
+	EXPECT_EQ(k_dbm_find_entry("missing/counter"), -1);
+	EXPECT_EQ(insert_in_nvm_count, 0);
+}
+
+TEST_F(k_dbmTest, incrementPersistsOrDefersNVMValue)
+{
+	k_dbm_config_t blob_config		= config;
+	blob_config.k_dbm_insert_blob_f = test_dbm_insert_blob;
+	blob_config.k_dbm_get_blob_f	= test_dbm_get_blob;
+	int64_t new_value				= 0;
+	EXPECT_EQ(k_dbm_init(&blob_config), 0);
+	EXPECT_EQ(k_dbm_set_i32("counter", 1, K_DBM_STORAGE_NVM), 0);
+	EXPECT_EQ(k_dbm_increment("counter", 1, &new_value, false), 0);
+	EXPECT_EQ(insert_blob_in_nvm_count, 2);
+	EXPECT_EQ(last_nvm_blob, std::string("\x00\x02\x02\x00\x00\x00", 6));
+
+	EXPECT_EQ(k_dbm_increment("counter", 1, &new_value, true), 0);
+	EXPECT_EQ(k_dbm_increment("counter", 1, &new_value, true), 0);
+	EXPECT_EQ(new_value, 4);
+	EXPECT_EQ(insert_blob_in_nvm_count, 2);
+	EXPECT_EQ(k_dbm_context.db.dirty_count, 1);
+	EXPECT_EQ(k_dbm_flush(), 0);
+	EXPECT_EQ(insert_blob_in_nvm_count, 3);
+	EXPECT_EQ(last_nvm_blob, std::string("\x00\x02\x04\x00\x00\x00", 6));
+	EXPECT_EQ(k_dbm_flush(), 0);
+	EXPECT_EQ(insert_blob_in_nvm_count, 3);
+
+	/* A persisted write supersedes the deferred value */
+	EXPECT_EQ(k_dbm_increment("counter", 1, &new_value, true), 0);
+	EXPECT_EQ(k_dbm_set_i32("counter", 0, K_DBM_STORAGE_NVM), 0);
+	EXPECT_EQ(k_dbm_context.db.dirty_count, 0);
+	EXPECT_EQ(insert_blob_in_nvm_count, 4);
+}
+
+TEST_F(k_dbmTest, incrementLoadsNVMValue)
+{
+	k_dbm_config_t blob_config		= config;
+	blob_config.k_dbm_insert_blob_f = test_dbm_insert_blob;
+	blob_config.k_dbm_get_blob_f	= test_dbm_get_blob;
+	int64_t new_value				= 0;
+	EXPECT_EQ(k_dbm_init(&blob_config), 0);
+	EXPECT_EQ(k_dbm_increment("nvmCounter", 10, &new_value, true), 0);
+	EXPECT_EQ(new_value, -204);
+	EXPECT_EQ(k_dbm_increment("nvmCounter", 10, &new_value, true), 0);
+	EXPECT_EQ(new_value, -194);
+	/* The string read stops at the record tag, the record is read again as a blob */
+	EXPECT_EQ(get_from_nvm_count, 2);
+	EXPECT_EQ(insert_blob_in_nvm_count, 0);
+}
+
+TEST_F(k_dbmTest, flushKeepsValueOnNVMFailure)
+{
+	k_dbm_config_t blob_config		= config;
+	blob_config.k_dbm_insert_blob_f = test_dbm_insert_blob;
+	EXPECT_EQ(k_dbm_init(&blob_config), 0);
+	EXPECT_EQ(k_dbm_set_i32("key_fail", 1, K_DBM_STORAGE_RAM), 0);
+	k_dbm_context.db.entries_a[k_dbm_find_entry("key_fail")].storage = K_DBM_STORAGE_NVM;
+	EXPECT_EQ(k_dbm_increment("key_fail", 1, nullptr, true), 0);
+	EXPECT_EQ(k_dbm_flush(), -1);
+	EXPECT_EQ(k_dbm_context.db.dirty_count, 1);
+	EXPECT_EQ(k_dbm_delete("key_fail"), 0);
+	EXPECT_EQ(k_dbm_context.db.dirty_count, 0);
+	EXPECT_EQ(k_dbm_flush(), 0);
+}
+
+#if K_DBM_NVM_CACHE_EVICTION
+/* Cache a NVM entry for every free entry of the DB */
+static void fill_with_nvm_entries(char (*keys)[16])
+{
+	char value_buffer[32] = {0};
+	for (size_t i = 0; i < K_DBM_DYNAMIC_DB_SIZE; i++)
+	{
+		snprintf(keys[i], sizeof(keys[i]), "cached%zu", i);
+		EXPECT_EQ(k_dbm_get(keys[i], value_buffer, sizeof(value_buffer)), 0);
+	}
+	EXPECT_EQ(k_dbm_get_free_space(), 0);
+}
+
+TEST_F(k_dbmTest, insertEvictsCleanEntryOfFullDB)
+{
+	static char	  keys[K_DBM_DYNAMIC_DB_SIZE][16];
+	k_dbm_stats_t stats = {};
+	fill_with_nvm_entries(keys);
+	EXPECT_EQ(k_dbm_insert("ramKey", "value", K_DBM_STORAGE_RAM), 0);
+	EXPECT_EQ(k_dbm_set_i32("ramCounter", 1, K_DBM_STORAGE_RAM), 0);
+	EXPECT_EQ(k_dbm_insert("nvmNewKey", "value", K_DBM_STORAGE_NVM), 0);
+	EXPECT_NE(k_dbm_find_entry("ramKey"), -1);
+	EXPECT_NE(k_dbm_find_entry("ramCounter"), -1);
+	EXPECT_NE(k_dbm_find_entry("nvmNewKey"), -1);
+	EXPECT_EQ(k_dbm_get_free_space(), 0);
+	EXPECT_EQ(k_dbm_get_stats(&stats), 0);
+	EXPECT_EQ(stats.evictions, 3);
+}
+
+#if K_DBM_ADMISSION_SKETCH_SIZE == 0
+TEST_F(k_dbmTest, nvmCacheFillEvictsCleanEntry)
+{
+	static char	  keys[K_DBM_DYNAMIC_DB_SIZE][16];
+	char		  value_buffer[32] = {0};
+	k_dbm_stats_t stats			   = {};
+	fill_with_nvm_entries(keys);
+	EXPECT_EQ(k_dbm_get("nvmKey", value_buffer, sizeof(value_buffer)), 0);
+	EXPECT_NE(k_dbm_find_entry("nvmKey"), -1);
+	EXPECT_EQ(k_dbm_find_entry(keys[0]), -1);
+	EXPECT_EQ(k_dbm_get_free_space(), 0);
+	EXPECT_EQ(k_dbm_get_stats(&stats), 0);
+	EXPECT_EQ(stats.evictions, 1);
+	for (size_t i = 1; i < K_DBM_DYNAMIC_DB_SIZE; i++)
+	{
+		EXPECT_NE(k_dbm_find_entry(keys[i]), -1);
+	}
+
+	/* The cached entry is a RAM hit */
+	const size_t nvm_reads = get_from_nvm_count;
+	EXPECT_EQ(k_dbm_get("nvmKey", value_buffer, sizeof(value_buffer)), 0);
+	EXPECT_STREQ(value_buffer, "nvmValue");
+	EXPECT_EQ(get_from_nvm_count, nvm_reads);
+}
+
+TEST_F(k_dbmTest, nvmCacheEvictionGivesSecondChance)
+{
+	static char keys[K_DBM_DYNAMIC_DB_SIZE][16];
+	char		value_buffer[32] = {0};
+	fill_with_nvm_entries(keys);
+	EXPECT_EQ(k_dbm_get(keys[0], value_buffer, sizeof(value_buffer)), 0);
+	EXPECT_EQ(k_dbm_get("nvmKey", value_buffer, sizeof(value_buffer)), 0);
+	EXPECT_NE(k_dbm_find_entry(keys[0]), -1);
+	EXPECT_EQ(k_dbm_find_entry(keys[1]), -1);
+}
+#else
+TEST_F(k_dbmTest, admissionRejectsOneOffRead)
+{
+	static char	  keys[K_DBM_DYNAMIC_DB_SIZE][16];
+	char		  value_buffer[32] = {0};
+	k_dbm_stats_t stats			   = {};
+	fill_with_nvm_entries(keys);
+	EXPECT_EQ(k_dbm_get("nvmKey", value_buffer, sizeof(value_buffer)), 0);
+	EXPECT_STREQ(value_buffer, "nvmValue");
+	EXPECT_EQ(k_dbm_find_entry("nvmKey"), -1);
+	EXPECT_EQ(k_dbm_get_stats(&stats), 0);
+	EXPECT_EQ(stats.admissions_rejected, 1);
+	EXPECT_EQ(stats.evictions, 0);
+
+	/* Read a second time, it is now more frequent than the resident entries */
+	EXPECT_EQ(k_dbm_get("nvmKey", value_buffer, sizeof(value_buffer)), 0);
+	EXPECT_NE(k_dbm_find_entry("nvmKey"), -1);
+	EXPECT_EQ(k_dbm_get_stats(&stats), 0);
+	EXPECT_EQ(stats.evictions, 1);
+}
+
+TEST_F(k_dbmTest, loadsDoNotFeedAdmissionSketch)
+{
+	static const char *const keys[]	 = {"nvmKey", "missingKey"};
+	const uint32_t			 samples = k_dbm_context.db.admission_samples;
+	EXPECT_EQ(k_dbm_warmup(keys, 1), 0);
+	EXPECT_EQ(k_dbm_prefetch(keys + 1, 1), 0);
+	EXPECT_NE(k_dbm_find_entry("nvmKey"), -1);
+	EXPECT_EQ(k_dbm_context.db.admission_samples, samples);
+}
+
+TEST_F(k_dbmTest, admissionKeepsFrequentEntriesAcrossSweep)
+{
+	static char keys[K_DBM_DYNAMIC_DB_SIZE][16];
+	static char sweep_keys[2 * K_DBM_DYNAMIC_DB_SIZE][16];
+	char		value_buffer[32] = {0};
+	fill_with_nvm_entries(keys);
+	for (size_t i = 0; i < K_DBM_DYNAMIC_DB_SIZE; i++)
+	{
+		EXPECT_EQ(k_dbm_get(keys[i], value_buffer, sizeof(value_buffer)), 0);
+	}
+	for (size_t i = 0; i < 2 * K_DBM_DYNAMIC_DB_SIZE; i++)
+	{
+		snprintf(sweep_keys[i], sizeof(sweep_keys[i]), "sweep%zu", i);
+		EXPECT_EQ(k_dbm_get(sweep_keys[i], value_buffer, sizeof(value_buffer)), 0);
+	}
+	for (size_t i = 0; i < K_DBM_DYNAMIC_DB_SIZE; i++)
+	{
+		EXPECT_NE(k_dbm_find_entry(keys[i]), -1);
+	}
+}
+#endif
+
+TEST_F(k_dbmTest, nvmCacheNeverEvictsRamEntries)
+{
+	static char keys[K_DBM_DYNAMIC_DB_SIZE][16];
+	char		value_buffer[32] = {0};
+	for (size_t i = 0; i < K_DBM_DYNAMIC_DB_SIZE; i++)
+	{
+		snprintf(keys[i], sizeof(keys[i]), "ram%zu", i);
+		EXPECT_EQ(k_dbm_insert(keys[i], "value", K_DBM_STORAGE_RAM), 0);
+	}
+	EXPECT_EQ(k_dbm_get("nvmKey", value_buffer, sizeof(value_buffer)), 0);
+	EXPECT_STREQ(value_buffer, "nvmValue");
+	EXPECT_EQ(k_dbm_find_entry("nvmKey"), -1);
+	for (size_t i = 0; i < K_DBM_DYNAMIC_DB_SIZE; i++)
+	{
+		EXPECT_NE(k_dbm_find_entry(keys[i]), -1);
+	}
+}
+
+TEST_F(k_dbmTest, nvmCacheNeverEvictsDirtyEntries)
+{
+	k_dbm_config_t blob_config		= config;
+	blob_config.k_dbm_insert_blob_f = test_dbm_insert_blob;
+	static char keys[K_DBM_DYNAMIC_DB_SIZE][16];
+	char		value_buffer[32] = {0};
+	EXPECT_EQ(k_dbm_init(&blob_config), 0);
+	for (size_t i = 0; i < K_DBM_DYNAMIC_DB_SIZE; i++)
+	{
+		snprintf(keys[i], sizeof(keys[i]), "counter%zu", i);
+		EXPECT_EQ(k_dbm_set_i32(keys[i], 0, K_DBM_STORAGE_NVM), 0);
+		EXPECT_EQ(k_dbm_increment(keys[i], 1, nullptr, true), 0);
+	}
+	EXPECT_EQ(k_dbm_get("nvmKey", value_buffer, sizeof(value_buffer)), 0);
+	EXPECT_EQ(k_dbm_find_entry("nvmKey"), -1);
+
+	/* Once saved, the entries can be evicted */
+	EXPECT_EQ(k_dbm_flush(), 0);
+	EXPECT_EQ(k_dbm_get("nvmKey", value_buffer, sizeof(value_buffer)), 0);
+	EXPECT_NE(k_dbm_find_entry("nvmKey"), -1);
+}
+#endif
+
+k_dbm_task_t async_task_f	 = nullptr;
+void		*async_task_ctx_p = nullptr;
+
+/* Keep the task, the test runs it in place of the worker */
+static int test_run_async(k_dbm_task_t task_f, void *ctx_p)
+{
+	async_task_f	 = task_f;
+	async_task_ctx_p = ctx_p;
+	return 0;
+}
+
+static int test_run_async_fail(k_dbm_task_t task_f, void *ctx_p) { return -1; }
+
+static const char *const warmup_keys[] = {"nvmKey", "warm/key"};
+
+TEST_F(k_dbmTest, warmupLoadsKeyList)
+{
+	char value_buffer[32] = {0};
+	EXPECT_EQ(k_dbm_warmup(warmup_keys, 2), 0);
+	EXPECT_EQ(get_from_nvm_count, 2);
+	EXPECT_NE(k_dbm_find_entry("nvmKey"), -1);
+	EXPECT_NE(k_dbm_find_entry("warm/key"), -1);
+	EXPECT_EQ(k_dbm_get("nvmKey", value_buffer, sizeof(value_buffer)), 0);
+	EXPECT_STREQ(value_buffer, "nvmValue");
+	EXPECT_EQ(get_from_nvm_count, 2);
+
+	/* Cached keys are not read again */
+	EXPECT_EQ(k_dbm_warmup(warmup_keys, 2), 0);
+	EXPECT_EQ(get_from_nvm_count, 2);
+}
+
+TEST_F(k_dbmTest, warmupRunsInBackground)
+{
+	k_dbm_config_t async_config	   = config;
+	async_config.k_dbm_run_async_f = test_run_async;
+	async_task_f				   = nullptr;
+	EXPECT_EQ(k_dbm_init(&async_config), 0);
+	EXPECT_EQ(k_dbm_warmup(warmup_keys, 2), 0);
+	EXPECT_EQ(get_from_nvm_count, 0);
+	ASSERT_NE(async_task_f, nullptr);
+
+	/* One warm-up at a time */
+	EXPECT_EQ(k_dbm_warmup(warmup_keys, 2), -1);
+	async_task_f(async_task_ctx_p);
+	EXPECT_EQ(get_from_nvm_count, 2);
+	EXPECT_NE(k_dbm_find_entry("warm/key"), -1);
+	EXPECT_EQ(mutex_lock_count, mutex_unlock_count);
+	EXPECT_EQ(k_dbm_warmup(warmup_keys, 2), 0);
+}
+
+TEST_F(k_dbmTest, warmupRunsInCallerWhenNotScheduled)
+{
+	k_dbm_config_t async_config	   = config;
+	async_config.k_dbm_run_async_f = test_run_async_fail;
+	EXPECT_EQ(k_dbm_init(&async_config), 0);
+	EXPECT_EQ(k_dbm_warmup(warmup_keys, 2), 0);
+	EXPECT_EQ(get_from_nvm_count, 2);
+	EXPECT_NE(k_dbm_find_entry("nvmKey"), -1);
+}
+
+TEST_F(k_dbmTest, warmupStopsWhenFull)
+{
+	static char keys[K_DBM_DYNAMIC_DB_SIZE][16];
+	for (size_t i = 0; i < K_DBM_DYNAMIC_DB_SIZE; i++)
+	{
+		snprintf(keys[i], sizeof(keys[i]), "ram%zu", i);
+		EXPECT_EQ(k_dbm_insert(keys[i], "value", K_DBM_STORAGE_RAM), 0);
+	}
+	EXPECT_EQ(k_dbm_warmup(warmup_keys, 2), 0);
+	EXPECT_EQ(get_from_nvm_count, 0);
+	EXPECT_EQ(k_dbm_find_entry("nvmKey"), -1);
+}
+
+/* Report the keys from a reused buffer, like a backend iterating over its storage */
+static int test_dbm_enumerate_transient(k_dbm_enumerate_cb_t callback_f, void *ctx_p)
+{
+	char key_buffer[16];
+	strcpy(key_buffer, "nvmKey");
+	callback_f(key_buffer, ctx_p);
+	strcpy(key_buffer, "warm/key");
+	callback_f(key_buffer, ctx_p);
+	memset(key_buffer, 0, sizeof(key_buffer));
+	return 0;
+}
+
+TEST_F(k_dbmTest, warmupEnumeratesNVM)
+{
+	k_dbm_config_t enumerate_config	   = config;
+	enumerate_config.k_dbm_enumerate_f = test_dbm_enumerate_transient;
+	EXPECT_EQ(k_dbm_warmup(nullptr, 0), -1);
+	EXPECT_EQ(k_dbm_init(&enumerate_config), 0);
+#if K_DBM_KEY_ARENA_SIZE > 0
+	char value_buffer[32] = {0};
+	EXPECT_EQ(k_dbm_warmup(nullptr, 0), 0);
+	EXPECT_EQ(get_from_nvm_count, 2);
+	EXPECT_EQ(k_dbm_get("nvmKey", value_buffer, sizeof(value_buffer)), 0);
+	EXPECT_STREQ(value_buffer, "nvmValue");
+	EXPECT_NE(k_dbm_find_entry("warm/key"), -1);
+	EXPECT_EQ(get_from_nvm_count, 2);
+#else
+	/* The enumerated keys do not outlive the callback */
+	EXPECT_EQ(k_dbm_warmup(nullptr, 0), -1);
+	EXPECT_EQ(get_from_nvm_count, 0);
+#endif
+}
+
+size_t get_batch_count	  = 0;
+size_t last_batch_size	  = 0;
+bool   write_during_batch = false;
+
+int test_dbm_get_batch(const char *const *keys, size_t key_count, char *values, size_t value_buffer_size, int *results)
+{
+	get_batch_count++;
+	last_batch_size = key_count;
+	if (write_during_batch)
+	{
+		/* Another thread saving a value while the batch is read */
+		k_dbm_insert("pf/b", "newValue", K_DBM_STORAGE_NVM);
+	}
+	for (size_t i = 0; i < key_count; i++)
+	{
+		char *value_p = values + i * value_buffer_size;
+		results[i]	  = 0 == strncmp(keys[i], "missing", strlen("missing")) ? -1 : 0;
+		strncpy(value_p, 0 == strcmp(keys[i], "nvmKey") ? "nvmValue" : "batch", value_buffer_size);
+		if (0 == strcmp(keys[i], "nvmCounter"))
+		{
+			memcpy(value_p, nvm_counter, sizeof(nvm_counter));
+			value_p[sizeof(nvm_counter)] = '\0';
+		}
+	}
+	return 0;
+}
+
+class k_dbmBatchTest : public k_dbmTest
+{
+   protected:
+	void SetUp() override
+	{
+		k_dbmTest::SetUp();
+		k_dbm_config_t batch_config	   = config;
+		batch_config.k_dbm_get_batch_f = test_dbm_get_batch;
+		k_dbm_init(&batch_config);
+		get_batch_count	   = 0;
+		last_batch_size	   = 0;
+		write_during_batch = false;
+	}
+};
+
+TEST_F(k_dbmTest, prefetchLoadsMissingKeys)
+{
+	static const char *const keys[]			  = {"nvmKey", "pf/cached", "missingKey"};
+	char					 value_buffer[32] = {0};
+	EXPECT_EQ(k_dbm_prefetch(nullptr, 0), -1);
+	EXPECT_EQ(k_dbm_insert("pf/cached", "value", K_DBM_STORAGE_NVM), 0);
+	EXPECT_EQ(k_dbm_prefetch(keys, 3), 0);
+	EXPECT_EQ(get_from_nvm_count, 2);
+	EXPECT_NE(k_dbm_find_entry("nvmKey"), -1);
+	EXPECT_EQ(k_dbm_find_entry("missingKey"), -1);
+	EXPECT_EQ(k_dbm_get("nvmKey", value_buffer, sizeof(value_buffer)), 0);
+	EXPECT_STREQ(value_buffer, "nvmValue");
+	EXPECT_EQ(get_from_nvm_count, 2);
+}
+
+TEST_F(k_dbmTest, prefetchRunsInBackground)
+{
+	static const char *const keys[]		  = {"nvmKey"};
+	k_dbm_config_t			 async_config = config;
+	async_config.k_dbm_run_async_f		  = test_run_async;
+	async_task_f						  = nullptr;
+	EXPECT_EQ(k_dbm_init(&async_config), 0);
+	EXPECT_EQ(k_dbm_prefetch(keys, 1), 0);
+	EXPECT_EQ(get_from_nvm_count, 0);
+	ASSERT_NE(async_task_f, nullptr);
+	EXPECT_EQ(k_dbm_prefetch(keys, 1), -1);
+
+	/* Prefetch and warm-up do not share their job */
+	k_dbm_task_t prefetch_task_f = async_task_f;
+	void		*prefetch_ctx_p	 = async_task_ctx_p;
+	EXPECT_EQ(k_dbm_warmup(warmup_keys, 2), 0);
+	EXPECT_NE(async_task_ctx_p, prefetch_ctx_p);
+	prefetch_task_f(prefetch_ctx_p);
+	EXPECT_EQ(get_from_nvm_count, 1);
+	EXPECT_NE(k_dbm_find_entry("nvmKey"), -1);
+	EXPECT_EQ(k_dbm_prefetch(keys, 1), 0);
+}
+
+TEST_F(k_dbmBatchTest, prefetchReadsInBatches)
+{
+	static const char *const keys[]			  = {"nvmKey", "pf/cached", "missingKey", "pf/a"};
+	char					 value_buffer[32] = {0};
+	EXPECT_EQ(k_dbm_insert("pf/cached", "value", K_DBM_STORAGE_NVM), 0);
+	EXPECT_EQ(k_dbm_prefetch(keys, 4), 0);
+	EXPECT_EQ(get_batch_count, 1);
+	EXPECT_EQ(last_batch_size, 3);
+	EXPECT_EQ(get_from_nvm_count, 0);
+	EXPECT_EQ(k_dbm_find_entry("missingKey"), -1);
+	EXPECT_EQ(k_dbm_get("nvmKey", value_buffer, sizeof(value_buffer)), 0);
+	EXPECT_STREQ(value_buffer, "nvmValue");
+	EXPECT_EQ(k_dbm_get("pf/a", value_buffer, sizeof(value_buffer)), 0);
+	EXPECT_STREQ(value_buffer, "batch");
+	EXPECT_EQ(k_dbm_get("pf/cached", value_buffer, sizeof(value_buffer)), 0);
+	EXPECT_STREQ(value_buffer, "value");
+	EXPECT_EQ(get_from_nvm_count, 0);
+	EXPECT_EQ(mutex_lock_count, mutex_unlock_count);
+}
+
+TEST_F(k_dbmBatchTest, prefetchSplitsBatches)
+{
+	static char key_buffers[K_DBM_LOAD_BATCH_SIZE + 1][16];
+	const char *keys[K_DBM_LOAD_BATCH_SIZE + 1];
+	for (size_t i = 0; i < K_DBM_LOAD_BATCH_SIZE + 1; i++)
+	{
+		snprintf(key_buffers[i], sizeof(key_buffers[i]), "pf/%zu", i);
+		keys[i] = key_buffers[i];
+	}
+	EXPECT_EQ(k_dbm_prefetch(keys, K_DBM_LOAD_BATCH_SIZE + 1), 0);
+	EXPECT_EQ(get_batch_count, 2);
+	EXPECT_EQ(last_batch_size, 1);
+	EXPECT_NE(k_dbm_find_entry(keys[K_DBM_LOAD_BATCH_SIZE]), -1);
+}
+
+TEST_F(k_dbmBatchTest, prefetchDropsBatchOverlappingWrite)
+{
+	static const char *const keys[]			  = {"pf/a", "pf/b"};
+	char					 value_buffer[32] = {0};
+	write_during_batch						  = true;
+	EXPECT_EQ(k_dbm_prefetch(keys, 2), 0);
+	EXPECT_EQ(k_dbm_find_entry("pf/a"), -1);
+	EXPECT_EQ(k_dbm_get("pf/b", value_buffer, sizeof(value_buffer)), 0);
+	EXPECT_STREQ(value_buffer, "newValue");
+}
+
+TEST_F(k_dbmBatchTest, warmupReadsInBatches)
+{
+	EXPECT_EQ(k_dbm_warmup(warmup_keys, 2), 0);
+	EXPECT_EQ(get_batch_count, 1);
+	EXPECT_EQ(get_from_nvm_count, 0);
+	EXPECT_NE(k_dbm_find_entry("warm/key"), -1);
+}
+
+TEST_F(k_dbmBatchTest, prefetchDecodesTypedValues)
+{
+	static const char *const keys[]		 = {"nvmCounter", "pf/a"};
+	k_dbm_config_t			 blob_config = config;
+	blob_config.k_dbm_get_batch_f		 = test_dbm_get_batch;
+	blob_config.k_dbm_get_blob_f		 = test_dbm_get_blob;
+	int32_t i32_value					 = 0;
+	char	value_buffer[32]			 = {0};
+	EXPECT_EQ(k_dbm_init(&blob_config), 0);
+	EXPECT_EQ(k_dbm_prefetch(keys, 2), 0);
+	EXPECT_EQ(get_batch_count, 1);
+	EXPECT_EQ(get_from_nvm_count, 1);
+	EXPECT_EQ(k_dbm_get_i32("nvmCounter", &i32_value), 0);
+	EXPECT_EQ(i32_value, -214);
+	EXPECT_EQ(k_dbm_get("pf/a", value_buffer, sizeof(value_buffer)), 0);
+	EXPECT_STREQ(value_buffer, "batch");
+	EXPECT_EQ(get_from_nvm_count, 1);
+}
+
+/* Whether the backend reads in batches must not change what a load leaves behind */
+TEST_F(k_dbmBatchTest, batchedAndSingleLoadsAgree)
+{
+	static const char *const keys[]			  = {"nvmKey", "missingKey"};
+	char					 value_buffer[32] = {0};
+	k_dbm_stats_t			 batched_stats	  = {};
+	k_dbm_stats_t			 single_stats	  = {};
+	EXPECT_EQ(k_dbm_prefetch(keys, 2), 0);
+	EXPECT_EQ(get_batch_count, 1);
+	EXPECT_EQ(k_dbm_get_stats(&batched_stats), 0);
+	EXPECT_EQ(k_dbm_get("missingKey", value_buffer, sizeof(value_buffer)), -1);
+	const int batched_nvm_reads = get_from_nvm_count;
+
+	EXPECT_EQ(k_dbm_init(&config), 0);
+	get_from_nvm_count = 0;
+	EXPECT_EQ(k_dbm_prefetch(keys, 2), 0);
+	EXPECT_EQ(get_from_nvm_count, 2);
+	EXPECT_EQ(k_dbm_get_stats(&single_stats), 0);
+	EXPECT_EQ(k_dbm_get("missingKey", value_buffer, sizeof(value_buffer)), -1);
+	EXPECT_EQ(get_from_nvm_count - 2, batched_nvm_reads);
+	EXPECT_EQ(single_stats.cache_misses, batched_stats.cache_misses);
+	EXPECT_EQ(single_stats.cache_hits, batched_stats.cache_hits);
+	/* Loads are not client reads */
+	EXPECT_EQ(single_stats.cache_misses, 0);
+	EXPECT_NE(k_dbm_find_entry("nvmKey"), -1);
+	EXPECT_EQ(k_dbm_find_entry("missingKey"), -1);
+}
+
+#if K_DBM_NVM_CACHE_EVICTION
+/* A prefetched key has not been read yet, the admission policy would never let it in a full DB */
+TEST_F(k_dbmTest, prefetchEvictsWhateverItsFrequency)
+{
+	static char				 keys[K_DBM_DYNAMIC_DB_SIZE][16];
+	static const char *const prefetch_keys[] = {"nvmKey"};
+	k_dbm_stats_t			 stats			 = {};
+	fill_with_nvm_entries(keys);
+	EXPECT_EQ(k_dbm_prefetch(prefetch_keys, 1), 0);
+	EXPECT_NE(k_dbm_find_entry("nvmKey"), -1);
+	EXPECT_EQ(k_dbm_get_stats(&stats), 0);
+	EXPECT_EQ(stats.evictions, 1);
+	EXPECT_EQ(stats.admissions_rejected, 0);
+}
+
+TEST_F(k_dbmBatchTest, batchPrefetchEvictsWhateverItsFrequency)
+{
+	static char				 keys[K_DBM_DYNAMIC_DB_SIZE][16];
+	static const char *const prefetch_keys[] = {"pf/a", "pf/b"};
+	k_dbm_stats_t			 stats			 = {};
+	fill_with_nvm_entries(keys);
+	EXPECT_EQ(k_dbm_prefetch(prefetch_keys, 2), 0);
+	EXPECT_EQ(get_batch_count, 1);
+	EXPECT_NE(k_dbm_find_entry("pf/a"), -1);
+	EXPECT_NE(k_dbm_find_entry("pf/b"), -1);
+	EXPECT_EQ(k_dbm_get_stats(&stats), 0);
+	EXPECT_EQ(stats.evictions, 2);
+	EXPECT_EQ(stats.admissions_rejected, 0);
+}
+#endif
+
+uint32_t test_time_ms = 0;
+
+static uint32_t test_get_time_ms(void) { return test_time_ms; }
+
+class k_dbmWriteBackTest : public k_dbmTest
+{
+   protected:
+	void SetUp() override
+	{
+		k_dbmTest::SetUp();
+		write_back_config.is_write_back = true;
+		k_dbm_init(&write_back_config);
+		test_time_ms = 0;
+		async_task_f = nullptr;
+	}
+
+	k_dbm_config_t write_back_config = config;
+};
+
+TEST_F(k_dbmWriteBackTest, writeBackDefersNVMWrite)
+{
+	char value_buffer[32] = {0};
+	EXPECT_EQ(k_dbm_insert("wb/key", "value", K_DBM_STORAGE_NVM), 0);
+	EXPECT_EQ(k_dbm_insert("wb/key", "value2", K_DBM_STORAGE_NVM), 0);
+	EXPECT_EQ(insert_in_nvm_count, 0);
+	EXPECT_EQ(k_dbm_get("wb/key", value_buffer, sizeof(value_buffer)), 0);
+	EXPECT_STREQ(value_buffer, "value2");
+	EXPECT_EQ(get_from_nvm_count, 0);
+
+	EXPECT_EQ(k_dbm_flush(), 0);
+	EXPECT_EQ(insert_in_nvm_count, 1);
+	EXPECT_EQ(k_dbm_flush(), 0);
+	EXPECT_EQ(insert_in_nvm_count, 1);
+	EXPECT_EQ(mutex_lock_count, mutex_unlock_count);
+}
+
+TEST_F(k_dbmWriteBackTest, writeBackLeavesRamWritesUnchanged)
+{
+	EXPECT_EQ(k_dbm_insert("wb/key", "value", K_DBM_STORAGE_RAM), 0);
+	EXPECT_EQ(k_dbm_flush(), 0);
+	EXPECT_EQ(insert_in_nvm_count, 0);
+}
+
+TEST_F(k_dbmWriteBackTest, writeBackKeepsFailedSaveDirty)
+{
+	char value_buffer[32] = {0};
+	EXPECT_EQ(k_dbm_insert("key_fail", "value", K_DBM_STORAGE_NVM), 0);
+	EXPECT_EQ(k_dbm_flush(), -1);
+	EXPECT_EQ(k_dbm_flush(), -1);
+	EXPECT_EQ(insert_in_nvm_count, 2);
+	EXPECT_EQ(k_dbm_get("key_fail", value_buffer, sizeof(value_buffer)), 0);
+	EXPECT_STREQ(value_buffer, "value");
+}
+
+TEST_F(k_dbmWriteBackTest, writeBackSavesTypedValueWithoutBlobCallbackAtOnce)
+{
+	/* The value could never be flushed, the write fails right away */
+	EXPECT_EQ(k_dbm_set_i32("wb/counter", 1, K_DBM_STORAGE_NVM), -1);
+	EXPECT_EQ(k_dbm_find_entry("wb/counter"), -1);
+}
+
+TEST_F(k_dbmWriteBackTest, writeBackDefersIncrement)
+{
+	write_back_config.k_dbm_insert_blob_f = test_dbm_insert_blob;
+	int64_t new_value					  = 0;
+	EXPECT_EQ(k_dbm_init(&write_back_config), 0);
+	EXPECT_EQ(k_dbm_set_i32("wb/counter", 1, K_DBM_STORAGE_NVM), 0);
+	EXPECT_EQ(k_dbm_increment("wb/counter", 1, &new_value, false), 0);
+	EXPECT_EQ(new_value, 2);
+	EXPECT_EQ(insert_blob_in_nvm_count, 0);
+	EXPECT_EQ(k_dbm_flush(), 0);
+	EXPECT_EQ(insert_blob_in_nvm_count, 1);
+}
+
+TEST_F(k_dbmWriteBackTest, writeBackFlushesAtDirtyThreshold)
+{
+	write_back_config.write_back_dirty_max = 3;
+	EXPECT_EQ(k_dbm_init(&write_back_config), 0);
+	EXPECT_EQ(k_dbm_insert("wb/a", "value", K_DBM_STORAGE_NVM), 0);
+	EXPECT_EQ(k_dbm_insert("wb/b", "value", K_DBM_STORAGE_NVM), 0);
+	EXPECT_EQ(insert_in_nvm_count, 0);
+	EXPECT_EQ(k_dbm_insert("wb/c", "value", K_DBM_STORAGE_NVM), 0);
+	EXPECT_EQ(insert_in_nvm_count, 3);
+	EXPECT_EQ(mutex_lock_count, mutex_unlock_count);
+}
+
+TEST_F(k_dbmWriteBackTest, writeBackFlushesAtAgeThreshold)
+{
+	write_back_config.k_dbm_get_time_ms_f	= test_get_time_ms;
+	write_back_config.write_back_max_age_ms = 100;
+	test_time_ms							= UINT32_MAX - 10;
+	EXPECT_EQ(k_dbm_init(&write_back_config), 0);
+	EXPECT_EQ(k_dbm_insert("wb/a", "value", K_DBM_STORAGE_NVM), 0);
+	test_time_ms += 50;
+	EXPECT_EQ(k_dbm_insert("wb/b", "value", K_DBM_STORAGE_NVM), 0);
+	EXPECT_EQ(insert_in_nvm_count, 0);
+
+	/* The age is counted from the oldest dirty value, across a time wrap around */
+	test_time_ms += 50;
+	EXPECT_EQ(k_dbm_insert("wb/c", "value", K_DBM_STORAGE_NVM), 0);
+	EXPECT_EQ(insert_in_nvm_count, 3);
+}
+
+TEST_F(k_dbmWriteBackTest, writeBackFlushSavesWithoutMutex)
+{
+	static bool is_locked = false;
+	EXPECT_EQ(k_dbm_insert("wb/key", "value", K_DBM_STORAGE_NVM), 0);
+	nvm_insert_hook = [](const char *key) { is_locked = mutex_lock_count != mutex_unlock_count; };
+	EXPECT_EQ(k_dbm_flush(), 0);
+	EXPECT_FALSE(is_locked);
+
+	/* No room to copy a longer key, the value is saved with the mutex held */
+	const std::string long_key(K_DBM_FLUSH_KEY_MAX_LENGTH, 'k');
+	EXPECT_EQ(k_dbm_insert(long_key.c_str(), "value", K_DBM_STORAGE_NVM), 0);
+	nvm_insert_hook = [](const char *key) { is_locked = mutex_lock_count != mutex_unlock_count; };
+	EXPECT_EQ(k_dbm_flush(), 0);
+	EXPECT_TRUE(is_locked);
+	EXPECT_EQ(insert_in_nvm_count, 2);
+	EXPECT_EQ(mutex_lock_count, mutex_unlock_count);
+}
+
+TEST_F(k_dbmWriteBackTest, writeBackFlushSavesValueRewrittenDuringSave)
+{
+	EXPECT_EQ(k_dbm_insert("wb/key", "value", K_DBM_STORAGE_NVM), 0);
+	nvm_insert_hook = [](const char *key) { EXPECT_EQ(k_dbm_insert("wb/key", "value2", K_DBM_STORAGE_NVM), 0); };
+	EXPECT_EQ(k_dbm_flush(), 0);
+	EXPECT_EQ(insert_in_nvm_count, 2);
+	EXPECT_EQ(last_nvm_value, "value2");
+	EXPECT_EQ(k_dbm_flush(), 0);
+	EXPECT_EQ(insert_in_nvm_count, 2);
+}
+
+TEST_F(k_dbmWriteBackTest, shutdownDefersWriteOfKeyBeingSaved)
+{
+	EXPECT_EQ(k_dbm_insert("wb/key", "value", K_DBM_STORAGE_NVM), 0);
+	nvm_insert_hook = [](const char *key)
+	{
+		/* Written through, the value could be overwritten by the older copy being saved */
+		EXPECT_EQ(k_dbm_insert("wb/key", "value2", K_DBM_STORAGE_NVM), 0);
+		EXPECT_EQ(insert_in_nvm_count, 1);
+	};
+	EXPECT_EQ(k_dbm_shutdown(), 0);
+	EXPECT_EQ(insert_in_nvm_count, 2);
+	EXPECT_EQ(last_nvm_value, "value2");
+}
+
+TEST_F(k_dbmWriteBackTest, writeBackFlushRepeatsDeleteDuringSave)
+{
+	char value_buffer[32] = {0};
+	EXPECT_EQ(k_dbm_insert("wb/key", "value", K_DBM_STORAGE_NVM), 0);
+	nvm_insert_hook = [](const char *key)
+	{
+		char value_buffer[32] = {0};
+		EXPECT_EQ(k_dbm_delete("wb/key"), 0);
+		/* The NVM copy is being written, the key is not read back from it */
+		EXPECT_EQ(k_dbm_get("wb/key", value_buffer, sizeof(value_buffer)), -1);
+		EXPECT_EQ(get_from_nvm_count, 0);
+	};
+	EXPECT_EQ(k_dbm_flush(), 0);
+	EXPECT_EQ(delete_from_nvm_count, 2);
+	EXPECT_EQ(k_dbm_find_entry("wb/key"), -1);
+	EXPECT_EQ(k_dbm_get("wb/key", value_buffer, sizeof(value_buffer)), 0);
+	EXPECT_EQ(get_from_nvm_count, 1);
+}
+
+TEST_F(k_dbmWriteBackTest, writeBackBacksOffAfterFailedSave)
+{
+	char value[16]							= {0};
+	write_back_config.k_dbm_get_time_ms_f	= test_get_time_ms;
+	write_back_config.write_back_max_age_ms = 10;
+	EXPECT_EQ(k_dbm_init(&write_back_config), 0);
+	EXPECT_EQ(k_dbm_insert("key_fail", "value", K_DBM_STORAGE_NVM), 0);
+	test_time_ms = 10;
+	EXPECT_EQ(k_dbm_insert("wb/a", "value", K_DBM_STORAGE_NVM), 0);
+	EXPECT_EQ(insert_in_nvm_count, 2);
+
+	/* The failed value does not make every following write flush again */
+	for (int i = 0; i < 10; i++)
+	{
+		snprintf(value, sizeof(value), "value%d", i);
+		EXPECT_EQ(k_dbm_insert("wb/b", value, K_DBM_STORAGE_NVM), 0);
+		test_time_ms++;
+	}
+	EXPECT_EQ(insert_in_nvm_count, 2);
+	EXPECT_EQ(k_dbm_insert("wb/c", "value", K_DBM_STORAGE_NVM), 0);
+	EXPECT_EQ(insert_in_nvm_count, 5);
+}
+
+TEST_F(k_dbmWriteBackTest, writeBackDirtyThresholdSkipsFailedSaves)
+{
+	write_back_config.write_back_dirty_max = 2;
+	EXPECT_EQ(k_dbm_init(&write_back_config), 0);
+	EXPECT_EQ(k_dbm_insert("key_fail", "value", K_DBM_STORAGE_NVM), 0);
+	EXPECT_EQ(k_dbm_insert("wb/a", "value", K_DBM_STORAGE_NVM), 0);
+	EXPECT_EQ(insert_in_nvm_count, 2);
+	EXPECT_EQ(k_dbm_insert("wb/b", "value", K_DBM_STORAGE_NVM), 0);
+	EXPECT_EQ(insert_in_nvm_count, 2);
+	EXPECT_EQ(k_dbm_insert("wb/c", "value", K_DBM_STORAGE_NVM), 0);
+	EXPECT_EQ(insert_in_nvm_count, 5);
+}
+
+TEST_F(k_dbmWriteBackTest, writeBackFlushesInBackground)
+{
+	write_back_config.k_dbm_run_async_f	   = test_run_async;
+	write_back_config.write_back_dirty_max = 1;
+	EXPECT_EQ(k_dbm_init(&write_back_config), 0);
+	EXPECT_EQ(k_dbm_insert("wb/a", "value", K_DBM_STORAGE_NVM), 0);
+	EXPECT_EQ(insert_in_nvm_count, 0);
+	ASSERT_NE(async_task_f, nullptr);
+
+	/* A single flush is scheduled at a time */
+	k_dbm_task_t flush_task_f = async_task_f;
+	async_task_f			  = nullptr;
+	EXPECT_EQ(k_dbm_insert("wb/b", "value", K_DBM_STORAGE_NVM), 0);
+	EXPECT_EQ(async_task_f, nullptr);
+	flush_task_f(async_task_ctx_p);
+	EXPECT_EQ(insert_in_nvm_count, 2);
+	EXPECT_EQ(k_dbm_insert("wb/c", "value", K_DBM_STORAGE_NVM), 0);
+	EXPECT_NE(async_task_f, nullptr);
+}
+
+TEST_F(k_dbmWriteBackTest, shutdownDrainsDirtyEntries)
+{
+	EXPECT_EQ(k_dbm_insert("wb/a", "value", K_DBM_STORAGE_NVM), 0);
+	EXPECT_EQ(k_dbm_insert("wb/b", "value", K_DBM_STORAGE_NVM), 0);
+	EXPECT_EQ(k_dbm_shutdown(), 0);
+	EXPECT_EQ(insert_in_nvm_count, 2);
+
+	/* Nothing is deferred anymore */
+	EXPECT_EQ(k_dbm_insert("wb/c", "value", K_DBM_STORAGE_NVM), 0);
+	EXPECT_EQ(insert_in_nvm_count, 3);
+}
+
+class k_dbmCoalesceTest : public k_dbmTest
+{
+   protected:
+	void SetUp() override
+	{
+		k_dbmTest::SetUp();
+		coalesce_config.k_dbm_get_time_ms_f = test_get_time_ms;
+		coalesce_config.write_coalesce_ms	= 100;
+		k_dbm_init(&coalesce_config);
+		test_time_ms = 0;
+	}
+
+	k_dbm_config_t coalesce_config = config;
+};
+
+TEST_F(k_dbmCoalesceTest, coalesceSavesLastValueOnly)
+{
+	char		  value_buffer[32] = {0};
+	char		  value[16]		   = {0};
+	k_dbm_stats_t stats			   = {};
+	for (int i = 1; i <= 5; i++)
+	{
+		snprintf(value, sizeof(value), "pos%d", i);
+		EXPECT_EQ(k_dbm_insert("gps/pos", value, K_DBM_STORAGE_NVM), 0);
+		EXPECT_EQ(k_dbm_get("gps/pos", value_buffer, sizeof(value_buffer)), 0);
+		EXPECT_STREQ(value_buffer, value);
+		test_time_ms += 20;
+	}
+	EXPECT_EQ(insert_in_nvm_count, 0);
+
+	/* The window of the first deferred write is over */
+	EXPECT_EQ(k_dbm_poll(), 0);
+	EXPECT_EQ(insert_in_nvm_count, 1);
+	EXPECT_EQ(last_nvm_value, "pos5");
+	EXPECT_EQ(k_dbm_get_stats(&stats), 0);
+	EXPECT_EQ(stats.writes_coalesced, 4);
+}
+
+TEST_F(k_dbmCoalesceTest, coalesceWindowStartsAtFirstDeferredWrite)
+{
+	EXPECT_EQ(k_dbm_insert("gps/pos", "pos1", K_DBM_STORAGE_NVM), 0);
+	test_time_ms = 99;
+	EXPECT_EQ(k_dbm_poll(), 0);
+	EXPECT_EQ(insert_in_nvm_count, 0);
+	test_time_ms = 100;
+	EXPECT_EQ(k_dbm_poll(), 0);
+	EXPECT_EQ(insert_in_nvm_count, 1);
+
+	/* A new window opens with the next write */
+	test_time_ms = 150;
+	EXPECT_EQ(k_dbm_insert("gps/pos", "pos2", K_DBM_STORAGE_NVM), 0);
+	test_time_ms = 249;
+	EXPECT_EQ(k_dbm_poll(), 0);
+	EXPECT_EQ(insert_in_nvm_count, 1);
+	test_time_ms = 250;
+	EXPECT_EQ(k_dbm_poll(), 0);
+	EXPECT_EQ(insert_in_nvm_count, 2);
+}
+
+TEST_F(k_dbmCoalesceTest, coalesceWindowIsPerKey)
+{
+	EXPECT_EQ(k_dbm_insert("gps/pos", "pos1", K_DBM_STORAGE_NVM), 0);
+	test_time_ms = 90;
+	EXPECT_EQ(k_dbm_insert("odometer", "42", K_DBM_STORAGE_NVM), 0);
+
+	/* The window of gps/pos is over, the one of odometer is not */
+	test_time_ms = 100;
+	EXPECT_EQ(k_dbm_poll(), 0);
+	EXPECT_EQ(insert_in_nvm_count, 1);
+	EXPECT_EQ(last_nvm_value, "pos1");
+	EXPECT_EQ(k_dbm_insert("odometer", "43", K_DBM_STORAGE_NVM), 0);
+	test_time_ms = 189;
+	EXPECT_EQ(k_dbm_poll(), 0);
+	EXPECT_EQ(insert_in_nvm_count, 1);
+	test_time_ms = 190;
+	EXPECT_EQ(k_dbm_poll(), 0);
+	EXPECT_EQ(insert_in_nvm_count, 2);
+	EXPECT_EQ(last_nvm_value, "43");
+}
+
+TEST_F(k_dbmCoalesceTest, coalesceReportsFailedSave)
+{
+	EXPECT_EQ(k_dbm_insert("key_fail", "value", K_DBM_STORAGE_NVM), 0);
+	test_time_ms = 100;
+	EXPECT_EQ(k_dbm_poll(), -1);
+	EXPECT_EQ(k_dbm_shutdown(), -1);
+}
+
+TEST_F(k_dbmTest, coalesceNeedsTimeSource)
+{
+	k_dbm_config_t coalesce_config	  = config;
+	coalesce_config.write_coalesce_ms = 100;
+	EXPECT_EQ(k_dbm_init(&coalesce_config), 0);
+	EXPECT_EQ(k_dbm_insert("gps/pos", "pos1", K_DBM_STORAGE_NVM), 0);
+	EXPECT_EQ(insert_in_nvm_count, 1);
+	EXPECT_EQ(k_dbm_poll(), 0);
+}
+
+TEST_F(k_dbmTest, deferredIncrementsAreCoalesced)
+{
+	k_dbm_config_t blob_config		= config;
+	blob_config.k_dbm_insert_blob_f = test_dbm_insert_blob;
+	k_dbm_stats_t stats				= {};
+	EXPECT_EQ(k_dbm_init(&blob_config), 0);
+	EXPECT_EQ(k_dbm_set_i32("counter", 0, K_DBM_STORAGE_NVM), 0);
+	EXPECT_EQ(k_dbm_increment("counter", 1, nullptr, true), 0);
+	EXPECT_EQ(k_dbm_increment("counter", 1, nullptr, true), 0);
+	EXPECT_EQ(k_dbm_increment("counter", 1, nullptr, false), 0);
+	EXPECT_EQ(insert_blob_in_nvm_count, 2);
+	EXPECT_EQ(k_dbm_get_stats(&stats), 0);
+	EXPECT_EQ(stats.writes_coalesced, 2);
+}
+
+TEST_F(k_dbmTest, shutdownSavesDeferredIncrement)
+{
+	k_dbm_config_t blob_config		= config;
+	blob_config.k_dbm_insert_blob_f = test_dbm_insert_blob;
+	EXPECT_EQ(k_dbm_init(&blob_config), 0);
+	EXPECT_EQ(k_dbm_set_i32("counter", 1, K_DBM_STORAGE_NVM), 0);
+	EXPECT_EQ(k_dbm_increment("counter", 1, nullptr, true), 0);
+	EXPECT_EQ(k_dbm_shutdown(), 0);
+	EXPECT_EQ(insert_blob_in_nvm_count, 2);
+	EXPECT_EQ(k_dbm_increment("counter", 1, nullptr, true), 0);
+	EXPECT_EQ(insert_blob_in_nvm_count, 3);
+}
+
+TEST_F(k_dbmTest, unchangedValueSkipsNVMWrite)
+{
+	k_dbm_stats_t stats = {};
+	EXPECT_EQ(k_dbm_insert("key", "value", K_DBM_STORAGE_NVM), 0);
+	EXPECT_EQ(k_dbm_insert("key", "value", K_DBM_STORAGE_NVM), 0);
+	EXPECT_EQ(insert_in_nvm_count, 1);
+	EXPECT_EQ(k_dbm_insert("key", "value2", K_DBM_STORAGE_NVM), 0);
+	EXPECT_EQ(insert_in_nvm_count, 2);
+	EXPECT_EQ(last_nvm_value, "value2");
+	EXPECT_EQ(k_dbm_get_stats(&stats), 0);
+	EXPECT_EQ(stats.writes_skipped, 1);
+}
+
+TEST_F(k_dbmTest, unchangedTypedValueSkipsNVMWrite)
+{
+	k_dbm_config_t blob_config		= config;
+	blob_config.k_dbm_insert_blob_f = test_dbm_insert_blob;
+	EXPECT_EQ(k_dbm_init(&blob_config), 0);
+	EXPECT_EQ(k_dbm_set_i32("counter", 7, K_DBM_STORAGE_NVM), 0);
+	EXPECT_EQ(k_dbm_set_i32("counter", 7, K_DBM_STORAGE_NVM), 0);
+	EXPECT_EQ(insert_blob_in_nvm_count, 1);
+	/* Same bytes, another type */
+	EXPECT_EQ(k_dbm_set_f32("counter", 0, K_DBM_STORAGE_NVM), 0);
+	EXPECT_EQ(k_dbm_set_i32("counter", 0, K_DBM_STORAGE_NVM), 0);
+	EXPECT_EQ(insert_blob_in_nvm_count, 3);
+}
+
+TEST_F(k_dbmTest, unchangedValueInOtherStorageIsWritten)
+{
+	EXPECT_EQ(k_dbm_insert("key", "value", K_DBM_STORAGE_RAM), 0);
+	EXPECT_EQ(k_dbm_insert("key", "value", K_DBM_STORAGE_NVM), 0);
+	EXPECT_EQ(insert_in_nvm_count, 1);
+}
+
+TEST_F(k_dbmWriteBackTest, unchangedValueIsNotDeferred)
+{
+	k_dbm_stats_t stats = {};
+	EXPECT_EQ(k_dbm_insert("wb/key", "value", K_DBM_STORAGE_NVM), 0);
+	EXPECT_EQ(k_dbm_insert("wb/key", "value", K_DBM_STORAGE_NVM), 0);
+	EXPECT_EQ(k_dbm_get_stats(&stats), 0);
+	EXPECT_EQ(stats.writes_skipped, 1);
+	EXPECT_EQ(stats.writes_coalesced, 0);
+	EXPECT_EQ(k_dbm_flush(), 0);
+	EXPECT_EQ(insert_in_nvm_count, 1);
+	EXPECT_EQ(k_dbm_insert("wb/key", "value", K_DBM_STORAGE_NVM), 0);
+	EXPECT_EQ(k_dbm_flush(), 0);
+	EXPECT_EQ(insert_in_nvm_count, 1);
+}
+
+TEST_F(k_dbmWriteBackTest, unchangedDirtyValueIsSavedAfterShutdown)
+{
+	EXPECT_EQ(k_dbm_insert("key_fail", "value", K_DBM_STORAGE_NVM), 0);
+	EXPECT_EQ(k_dbm_shutdown(), -1);
+	/* Write-through again, the value is not in NVM yet */
+	EXPECT_EQ(k_dbm_insert("key_fail", "value", K_DBM_STORAGE_NVM), -1);
+	EXPECT_EQ(insert_in_nvm_count, 2);
+}
+
+#ifdef K_DBM_KEY_REGISTRY
+TEST_F(k_dbmTest, insertAndGetById)
+{
+	char value_buffer[32] = {0};
+	EXPECT_EQ(k_dbm_insert_by_id(K_DBM_KEY_NET_ETH0_IP, "10.0.0.1", K_DBM_STORAGE_RAM), 0);
+	EXPECT_EQ(k_dbm_context.db.entries_a[K_DBM_STATIC_KEY_INDEX(K_DBM_KEY_NET_ETH0_IP)].storage, K_DBM_STORAGE_RAM);
+	EXPECT_EQ(k_dbm_get_by_id(K_DBM_KEY_NET_ETH0_IP, value_buffer, sizeof(value_buffer)), 0);
+	EXPECT_STREQ(value_buffer, "10.0.0.1");
+	EXPECT_EQ(k_dbm_get_free_space(), K_DBM_DYNAMIC_DB_SIZE);
+}
+
+TEST_F(k_dbmTest, staticKeyReachableByString)
+{
+	char value_buffer[32] = {0};
+	EXPECT_EQ(k_dbm_insert("net/eth0/mask", "255.0.0.0", K_DBM_STORAGE_NVM), 0);
+	EXPECT_EQ(k_dbm_find_entry("net/eth0/mask"), K_DBM_STATIC_KEY_INDEX(K_DBM_KEY_NET_ETH0_MASK));
+	EXPECT_EQ(k_dbm_get_by_id(K_DBM_KEY_NET_ETH0_MASK, value_buffer, sizeof(value_buffer)), 0);
+	EXPECT_STREQ(value_buffer, "255.0.0.0");
+	EXPECT_EQ(k_dbm_delete("net/eth0/mask"), 0);
+	EXPECT_EQ(k_dbm_find_entry("net/eth0/mask"), -1);
+	EXPECT_EQ(delete_from_nvm_count, 1);
+}
+
+TEST_F(k_dbmTest, getByIdMissLoadsFromNVM)
+{
+	char value_buffer[32] = {0};
+	EXPECT_EQ(k_dbm_get_by_id(K_DBM_KEY_DEVICE_SERIAL, value_buffer, sizeof(value_buffer)), 0);
+	EXPECT_EQ(get_from_nvm_count, 1);
+	EXPECT_EQ(k_dbm_context.db.entries_a[K_DBM_STATIC_KEY_INDEX(K_DBM_KEY_DEVICE_SERIAL)].storage, K_DBM_STORAGE_NVM);
+	EXPECT_EQ(k_dbm_get_by_id(K_DBM_KEY_DEVICE_SERIAL, value_buffer, sizeof(value_buffer)), 0);
+	EXPECT_EQ(get_from_nvm_count, 1);
+}
+#endif
+
+TEST(k_dbm_arena, allocUntilFullThenReuseFreedSpace)
+{
+	uint32_t	  buffer[16];
+	k_dbm_arena_t arena;
+	k_dbm_arena_init(&arena, buffer, sizeof(buffer));
+	const uint32_t first  = k_dbm_arena_alloc(&arena, 20);
+	const uint32_t second = k_dbm_arena_alloc(&arena, 20);
+	EXPECT_NE(first, K_DBM_ARENA_INVALID_OFFSET);
+	EXPECT_NE(second, K_DBM_ARENA_INVALID_OFFSET);
+	EXPECT_EQ(k_dbm_arena_alloc(&arena, 20), K_DBM_ARENA_INVALID_OFFSET);
+	k_dbm_arena_free(&arena, first);
+	EXPECT_EQ(k_dbm_arena_alloc(&arena, 20), first);
+}
+
+TEST(k_dbm_arena, freedNeighboursAreMerged)
+{
+	uint32_t	  buffer[32];
+	k_dbm_arena_t arena;
+	k_dbm_arena_init(&arena, buffer, sizeof(buffer));
+	const uint32_t first  = k_dbm_arena_alloc(&arena, 24);
+	const uint32_t second = k_dbm_arena_alloc(&arena, 24);
+	const uint32_t third  = k_dbm_arena_alloc(&arena, 24);
+	EXPECT_NE(third, K_DBM_ARENA_INVALID_OFFSET);
+	k_dbm_arena_free(&arena, first);
+	k_dbm_arena_free(&arena, third);
+	k_dbm_arena_free(&arena, second);
+	EXPECT_EQ(arena.used, 0);
+	EXPECT_NE(k_dbm_arena_alloc(&arena, sizeof(buffer) - 8), K_DBM_ARENA_INVALID_OFFSET);
+}
+
+TEST(k_dbm_arena, shrinkGivesTailBack)
+{
+	uint32_t	  buffer[16];
+	k_dbm_arena_t arena;
+	k_dbm_arena_init(&arena, buffer, sizeof(buffer));
+	const uint32_t first = k_dbm_arena_alloc(&arena, 40);
+	EXPECT_GE(k_dbm_arena_capacity(&arena, first), 40);
+	EXPECT_EQ(k_dbm_arena_alloc(&arena, 20), K_DBM_ARENA_INVALID_OFFSET);
+	k_dbm_arena_shrink(&arena, first, 4);
+	EXPECT_GE(k_dbm_arena_capacity(&arena, first), 4);
+	EXPECT_LT(k_dbm_arena_capacity(&arena, first), 40);
+	EXPECT_NE(k_dbm_arena_alloc(&arena, 20), K_DBM_ARENA_INVALID_OFFSET);
+}
+
+#if K_DBM_KEY_ARENA_SIZE > 0
+TEST_F(k_dbmTest, keyArenaCopiesTemporaryKeys)
+{
+	char value_buffer[32] = {0};
+	char key_buffer[32];
+	strcpy(key_buffer, "stack_key");
+	EXPECT_EQ(k_dbm_insert(key_buffer, "value", K_DBM_STORAGE_RAM), 0);
+	EXPECT_NE(k_dbm_context.db.entries_a[0].key, key_buffer);
+	strcpy(key_buffer, "other_key");
+	EXPECT_EQ(k_dbm_get("stack_key", value_buffer, sizeof(value_buffer)), 0);
+	EXPECT_STREQ(value_buffer, "value");
+}
+
+TEST_F(k_dbmTest, keyArenaStoresKeyOnce)
+{
+	char key_buffer[32];
+	strcpy(key_buffer, "key");
+	EXPECT_EQ(k_dbm_insert(key_buffer, "value", K_DBM_STORAGE_RAM), 0);
+	const char	  *stored_key_p = k_dbm_context.db.entries_a[0].key;
+	const uint32_t used			= k_dbm_context.db.key_arena.used;
+	EXPECT_EQ(k_dbm_insert(key_buffer, "new_value", K_DBM_STORAGE_RAM), 0);
+	EXPECT_EQ(k_dbm_context.db.entries_a[0].key, stored_key_p);
+	EXPECT_EQ(k_dbm_context.db.key_arena.used, used);
+}
+
+TEST_F(k_dbmTest, keyArenaCopiesCachedNVMKeys)
+{
+	char value_buffer[32] = {0};
+	char key_buffer[32];
+	strcpy(key_buffer, "nvmKey");
+	EXPECT_EQ(k_dbm_get(key_buffer, value_buffer, sizeof(value_buffer)), 0);
+	EXPECT_NE(k_dbm_context.db.entries_a[0].key, key_buffer);
+	EXPECT_STREQ(k_dbm_context.db.entries_a[0].key, "nvmKey");
+}
+
+TEST_F(k_dbmTest, keyArenaFullAndReleasedOnDelete)
+{
+	static char big_key[K_DBM_KEY_ARENA_SIZE / 2];
+	memset(big_key, 'a', sizeof(big_key) - 1);
+	EXPECT_EQ(k_dbm_insert(big_key, "value", K_DBM_STORAGE_RAM), 0);
+	big_key[0] = 'b';
+	EXPECT_EQ(k_dbm_insert(big_key, "value", K_DBM_STORAGE_RAM), -1);
+	EXPECT_EQ(k_dbm_get_free_space(), K_DBM_DYNAMIC_DB_SIZE - 1);
+	big_key[0] = 'a';
+	EXPECT_EQ(k_dbm_delete(big_key), 0);
+	EXPECT_EQ(k_dbm_context.db.key_arena.used, 0);
+	big_key[0] = 'b';
+	EXPECT_EQ(k_dbm_insert(big_key, "value", K_DBM_STORAGE_RAM), 0);
+}
+#endif
+
+TEST_F(k_dbmTest, valueLengthIsTracked)
+{
+	char value_buffer[32] = {0};
+	EXPECT_EQ(k_dbm_insert("key", "a_long_value", K_DBM_STORAGE_RAM), 0);
+	EXPECT_EQ(k_dbm_context.db.entries_a[0].value_len, strlen("a_long_value"));
+	EXPECT_EQ(k_dbm_insert("key", "abc", K_DBM_STORAGE_RAM), 0);
+	EXPECT_EQ(k_dbm_context.db.entries_a[0].value_len, 3);
+	EXPECT_EQ(k_dbm_get("key", value_buffer, 4), 0);
+	EXPECT_STREQ(value_buffer, "abc");
+	EXPECT_EQ(k_dbm_get("key", value_buffer, 3), -1);
+	EXPECT_EQ(k_dbm_get("nvmKey", value_buffer, sizeof(value_buffer)), 0);
+	EXPECT_EQ(k_dbm_context.db.entries_a[1].value_len, strlen("nvmValue"));
+}
+
+#if K_DBM_VALUE_STORAGE == K_DBM_VALUE_STORAGE_INLINE
+TEST_F(k_dbmTest, inlineValueBytesAreClearedUpToTheUsedLength)
+{
+	const char zero[K_DBM_VALUE_MAX_LENGTH] = {0};
+	EXPECT_EQ(k_dbm_insert("key", "a_long_value", K_DBM_STORAGE_RAM), 0);
+	EXPECT_EQ(k_dbm_insert("key", "abc", K_DBM_STORAGE_RAM), 0);
+	EXPECT_EQ(memcmp(k_dbm_context.db.values_a[0] + 3, zero, sizeof(zero) - 3), 0);
+	EXPECT_EQ(k_dbm_delete("key"), 0);
+	EXPECT_EQ(memcmp(k_dbm_context.db.values_a[0], zero, sizeof(zero)), 0);
+	EXPECT_EQ(k_dbm_context.db.entries_a[0].value_len, 0);
+}
+#endif
+
+#if K_DBM_VALUE_STORAGE == K_DBM_VALUE_STORAGE_ARENA
+TEST_F(k_dbmTest, valueArenaStoresValueBytesOnly)
+{
+	char value_buffer[32] = {0};
+	EXPECT_EQ(k_dbm_insert("empty", "", K_DBM_STORAGE_RAM), 0);
+	EXPECT_EQ(k_dbm_context.db.value_arena.used, 0);
+	EXPECT_EQ(k_dbm_get("empty", value_buffer, sizeof(value_buffer)), 0);
+	EXPECT_STREQ(value_buffer, "");
+	EXPECT_EQ(k_dbm_insert("key", "abc", K_DBM_STORAGE_RAM), 0);
+	EXPECT_EQ(k_dbm_context.db.value_arena.used, 12);
+	EXPECT_EQ(k_dbm_context.db.entries_a[1].value_len, 3);
+	EXPECT_EQ(k_dbm_delete("key"), 0);
+	EXPECT_EQ(k_dbm_context.db.value_arena.used, 0);
+}
+
+TEST_F(k_dbmTest, valueArenaUpdateShrinksAndGrows)
+{
+	char value_buffer[32] = {0};
+	EXPECT_EQ(k_dbm_insert("key", "a_rather_long_value", K_DBM_STORAGE_RAM), 0);
+	const uint32_t long_used = k_dbm_context.db.value_arena.used;
+	EXPECT_EQ(k_dbm_insert("key", "abc", K_DBM_STORAGE_RAM), 0);
+	EXPECT_LT(k_dbm_context.db.value_arena.used, long_used);
+	EXPECT_EQ(k_dbm_insert("key", "a_rather_long_value", K_DBM_STORAGE_RAM), 0);
+	EXPECT_EQ(k_dbm_context.db.value_arena.used, long_used);
+	EXPECT_EQ(k_dbm_get("key", value_buffer, sizeof(value_buffer)), 0);
+	EXPECT_STREQ(value_buffer, "a_rather_long_value");
+}
+
+TEST_F(k_dbmTest, valueArenaFull)
+{
+	static char keys[K_DBM_DB_SIZE][16];
+	char		value_buffer[32] = {0};
+	std::string big_value(K_DBM_VALUE_MAX_LENGTH - 1, 'v');
+	size_t		count = 0;
+	while (count < K_DBM_DYNAMIC_DB_SIZE)
+	{
+		snprintf(keys[count], sizeof(keys[count]), "key%zu", count);
+		if (0 != k_dbm_insert(keys[count], big_value.c_str(), K_DBM_STORAGE_RAM))
+		{
+			break;
+		}
+		count++;
+	}
+	ASSERT_LT(count, K_DBM_DYNAMIC_DB_SIZE);
+	EXPECT_EQ(k_dbm_get_free_space(), K_DBM_DYNAMIC_DB_SIZE - count);
+
+	/* A failed update keeps the previous value */
+	EXPECT_EQ(k_dbm_insert(keys[0], "short", K_DBM_STORAGE_RAM), 0);
+	EXPECT_EQ(k_dbm_insert(keys[0], big_value.c_str(), K_DBM_STORAGE_RAM), -1);
+	EXPECT_EQ(k_dbm_get(keys[0], value_buffer, sizeof(value_buffer)), 0);
+	EXPECT_STREQ(value_buffer, "short");
+
+	/* A NVM write succeeds even if its value cannot be cached */
+	EXPECT_EQ(k_dbm_insert("nvmKey", big_value.c_str(), K_DBM_STORAGE_NVM), 0);
+	EXPECT_EQ(k_dbm_find_entry("nvmKey"), -1);
+	EXPECT_EQ(k_dbm_get("nvmKey", value_buffer, sizeof(value_buffer)), 0);
+	EXPECT_STREQ(value_buffer, "nvmValue");
+	EXPECT_EQ(get_from_nvm_count, 1);
+}
+#endif
+
+#if K_DBM_VALUE_STORAGE == K_DBM_VALUE_STORAGE_SLAB && K_DBM_SLAB_CLASS_1_COUNT > 0 && K_DBM_SLAB_CLASS_0_SIZE < K_DBM_VALUE_MAX_LENGTH
+/* Values landing in the first and in the second slab class */
+static const std::string slab_short_value(K_DBM_SLAB_CLASS_0_SIZE - 1, 's');
+static const std::string slab_long_value(K_DBM_SLAB_CLASS_0_SIZE, 'l');
+
+TEST_F(k_dbmTest, slabPicksSmallestClass)
+{
+	char value_buffer[K_DBM_VALUE_MAX_LENGTH] = {0};
+	EXPECT_EQ(k_dbm_insert("short", slab_short_value.c_str(), K_DBM_STORAGE_RAM), 0);
+	EXPECT_EQ(k_dbm_slab_capacity(k_dbm_context.db.entries_a[0].value_offset), K_DBM_SLAB_STRIDE(K_DBM_SLAB_CLASS_0_SIZE));
+	EXPECT_EQ(k_dbm_insert("long", slab_long_value.c_str(), K_DBM_STORAGE_RAM), 0);
+	EXPECT_EQ(k_dbm_slab_capacity(k_dbm_context.db.entries_a[1].value_offset), K_DBM_SLAB_STRIDE(K_DBM_SLAB_CLASS_1_SIZE));
+	EXPECT_EQ(k_dbm_get("long", value_buffer, sizeof(value_buffer)), 0);
+	EXPECT_EQ(slab_long_value, value_buffer);
+}
+
+TEST_F(k_dbmTest, slabUpdateMovesBetweenClasses)
+{
+	char value_buffer[K_DBM_VALUE_MAX_LENGTH] = {0};
+	EXPECT_EQ(k_dbm_insert("key", slab_short_value.c_str(), K_DBM_STORAGE_RAM), 0);
+	const uint32_t short_offset = k_dbm_context.db.entries_a[0].value_offset;
+	EXPECT_EQ(k_dbm_insert("key", "x", K_DBM_STORAGE_RAM), 0);
+	EXPECT_EQ(k_dbm_context.db.entries_a[0].value_offset, short_offset);
+	EXPECT_EQ(k_dbm_insert("key", slab_long_value.c_str(), K_DBM_STORAGE_RAM), 0);
+	EXPECT_EQ(k_dbm_slab_capacity(k_dbm_context.db.entries_a[0].value_offset), K_DBM_SLAB_STRIDE(K_DBM_SLAB_CLASS_1_SIZE));
+	EXPECT_EQ(k_dbm_context.db.value_slab_free_a[0], short_offset);
+	EXPECT_EQ(k_dbm_insert("key", slab_short_value.c_str(), K_DBM_STORAGE_RAM), 0);
+	EXPECT_EQ(k_dbm_context.db.entries_a[0].value_offset, short_offset);
+	EXPECT_EQ(k_dbm_get("key", value_buffer, sizeof(value_buffer)), 0);
+	EXPECT_EQ(slab_short_value, value_buffer);
+}
+
+TEST_F(k_dbmTest, slabFullClassSpillsIntoLargerOne)
+{
+	for (size_t i = 0; i < K_DBM_SLAB_CLASS_0_COUNT; i++)
+	{
+		EXPECT_EQ(k_dbm_slab_capacity(k_dbm_slab_alloc(1)), K_DBM_SLAB_STRIDE(K_DBM_SLAB_CLASS_0_SIZE));
+	}
+	const uint32_t spilled = k_dbm_slab_alloc(1);
+	EXPECT_EQ(k_dbm_slab_capacity(spilled), K_DBM_SLAB_STRIDE(K_DBM_SLAB_CLASS_1_SIZE));
+	k_dbm_slab_free(spilled);
+	EXPECT_EQ(k_dbm_context.db.value_slab_free_a[1], spilled);
+}
+
+#if K_DBM_SLAB_CLASS_2_COUNT == 0 && K_DBM_SLAB_CLASS_1_COUNT < K_DBM_DYNAMIC_DB_SIZE
+TEST_F(k_dbmTest, slabFullClassRejectsValue)
+{
+	static char keys[K_DBM_SLAB_CLASS_1_COUNT + 1][16];
+	for (size_t i = 0; i <= K_DBM_SLAB_CLASS_1_COUNT; i++)
+	{
+		snprintf(keys[i], sizeof(keys[i]), "key%zu", i);
+		EXPECT_EQ(k_dbm_insert(keys[i], slab_long_value.c_str(), K_DBM_STORAGE_RAM), i < K_DBM_SLAB_CLASS_1_COUNT ? 0 : -1);
+	}
+	EXPECT_EQ(k_dbm_insert(keys[K_DBM_SLAB_CLASS_1_COUNT], slab_short_value.c_str(), K_DBM_STORAGE_RAM), 0);
+	EXPECT_EQ(k_dbm_delete(keys[0]), 0);
+	EXPECT_EQ(k_dbm_insert(keys[K_DBM_SLAB_CLASS_1_COUNT], slab_long_value.c_str(), K_DBM_STORAGE_RAM), 0);
+}
+#endif
+#endif
+
+#if K_DBM_NEGATIVE_CACHE_SIZE > 0
+TEST_F(k_dbmTest, negativeCacheSkipsRepeatedMiss)
+{
+	char value_buffer[32] = {0};
+	EXPECT_EQ(k_dbm_get("missing_a", value_buffer, sizeof(value_buffer)), -1);
+	EXPECT_EQ(k_dbm_get("missing_a", value_buffer, sizeof(value_buffer)), -1);
+	EXPECT_EQ(get_from_nvm_count, 1);
+	EXPECT_EQ(mutex_lock_count, 2);
+	EXPECT_EQ(mutex_unlock_count, 2);
+}
+
+TEST_F(k_dbmTest, negativeCacheForgetsInsertedKey)
+{
+	char value_buffer[32] = {0};
+	EXPECT_EQ(k_dbm_get("missing_a", value_buffer, sizeof(value_buffer)), -1);
+	EXPECT_EQ(k_dbm_insert("missing_a", "value", K_DBM_STORAGE_RAM), 0);
+	EXPECT_EQ(k_dbm_get("missing_a", value_buffer, sizeof(value_buffer)), 0);
+	EXPECT_STREQ(value_buffer, "value");
+	EXPECT_EQ(k_dbm_delete("missing_a"), 0);
+	EXPECT_EQ(k_dbm_get("missing_a", value_buffer, sizeof(value_buffer)), -1);
+	EXPECT_EQ(get_from_nvm_count, 2);
+}
+
+TEST_F(k_dbmTest, negativeCacheEvictsOldestKey)
+{
+	char		value_buffer[32] = {0};
+	std::string keys[K_DBM_NEGATIVE_CACHE_SIZE + 1];
+	for (size_t i = 0; i <= K_DBM_NEGATIVE_CACHE_SIZE; i++)
+	{
+		keys[i] = "missing_" + std::to_string(i);
+		EXPECT_EQ(k_dbm_get(keys[i].c_str(), value_buffer, sizeof(value_buffer)), -1);
+	}
+	EXPECT_EQ(get_from_nvm_count, K_DBM_NEGATIVE_CACHE_SIZE + 1);
+	EXPECT_EQ(k_dbm_get(keys[K_DBM_NEGATIVE_CACHE_SIZE].c_str(), value_buffer, sizeof(value_buffer)), -1);
+	EXPECT_EQ(get_from_nvm_count, K_DBM_NEGATIVE_CACHE_SIZE + 1);
+	EXPECT_EQ(k_dbm_get(keys[0].c_str(), value_buffer, sizeof(value_buffer)), -1);
+	EXPECT_EQ(get_from_nvm_count, K_DBM_NEGATIVE_CACHE_SIZE + 2);
+}
+
+TEST_F(k_dbmTest, negativeCacheIgnoresLongKeys)
+{
+	char			  value_buffer[32] = {0};
+	const std::string key			   = "missing_" + std::string(K_DBM_NEGATIVE_CACHE_KEY_MAX_LENGTH, 'x');
+	EXPECT_EQ(k_dbm_get(key.c_str(), value_buffer, sizeof(value_buffer)), -1);
+	EXPECT_EQ(k_dbm_get(key.c_str(), value_buffer, sizeof(value_buffer)), -1);
+	EXPECT_EQ(get_from_nvm_count, 2);
+}
+#endif
+
+#if K_DBM_NVM_FILTER_SIZE > 0
+static int test_dbm_enumerate(k_dbm_enumerate_cb_t callback_f, void *ctx_p)
+{
+	callback_f("nvmKey", ctx_p);
+	callback_f("enumerated/key", ctx_p);
+	return 0;
+}
+
+static int test_dbm_enumerate_fail(k_dbm_enumerate_cb_t callback_f, void *ctx_p)
+{
+	callback_f("nvmKey", ctx_p);
+	return -1;
+}
+
+static uint32_t test_key_hash(const char *key_p)
+{
+	size_t key_len = 0;
+	return k_dbm_hash_key(key_p, &key_len);
+}
+
+TEST_F(k_dbmTest, nvmFilterSkipsNVMForAbsentKey)
+{
+	k_dbm_config_t filter_config	= config;
+	filter_config.k_dbm_enumerate_f = test_dbm_enumerate;
+	char value_buffer[32]			= {0};
+	EXPECT_EQ(k_dbm_init(&filter_config), 0);
+	EXPECT_EQ(k_dbm_get("unknown_key", value_buffer, sizeof(value_buffer)), -1);
+	EXPECT_EQ(get_from_nvm_count, 0);
+	EXPECT_EQ(k_dbm_get("nvmKey", value_buffer, sizeof(value_buffer)), 0);
+	EXPECT_STREQ(value_buffer, "nvmValue");
+	EXPECT_EQ(get_from_nvm_count, 1);
+}
+
+TEST_F(k_dbmTest, nvmFilterFollowsInsertAndDelete)
+{
+	k_dbm_config_t filter_config	= config;
+	filter_config.k_dbm_enumerate_f = test_dbm_enumerate;
+	EXPECT_EQ(k_dbm_init(&filter_config), 0);
+	EXPECT_EQ(k_dbm_nvm_filter_may_contain(test_key_hash("new_key")), 0);
+	EXPECT_EQ(k_dbm_insert("new_key", "value", K_DBM_STORAGE_NVM), 0);
+	EXPECT_EQ(k_dbm_insert("new_key", "value2", K_DBM_STORAGE_NVM), 0);
+	EXPECT_EQ(k_dbm_nvm_filter_may_contain(test_key_hash("new_key")), 1);
+	EXPECT_EQ(k_dbm_delete("new_key"), 0);
+	EXPECT_EQ(k_dbm_nvm_filter_may_contain(test_key_hash("new_key")), 0);
+	EXPECT_EQ(k_dbm_nvm_filter_may_contain(test_key_hash("enumerated/key")), 1);
+}
+
+TEST_F(k_dbmTest, nvmFilterIgnoresRamKeys)
+{
+	k_dbm_config_t filter_config	= config;
+	filter_config.k_dbm_enumerate_f = test_dbm_enumerate;
+	EXPECT_EQ(k_dbm_init(&filter_config), 0);
+	EXPECT_EQ(k_dbm_insert("ram_key", "value", K_DBM_STORAGE_RAM), 0);
+	EXPECT_EQ(k_dbm_nvm_filter_may_contain(test_key_hash("ram_key")), 0);
+}
+
+TEST_F(k_dbmTest, nvmFilterUnusedWithoutCompleteEnumeration)
+{
+	char value_buffer[32] = {0};
+	EXPECT_EQ(k_dbm_get("unknown_key", value_buffer, sizeof(value_buffer)), 0);
+	EXPECT_EQ(get_from_nvm_count, 1);
+
+	k_dbm_config_t filter_config	= config;
+	filter_config.k_dbm_enumerate_f = test_dbm_enumerate_fail;
+	EXPECT_EQ(k_dbm_init(&filter_config), 0);
+	EXPECT_EQ(k_dbm_nvm_filter_may_contain(test_key_hash("unknown_key")), 1);
+}
+#endif